@@ -0,0 +1,68 @@
+/**
+ * @file boot_status.cpp
+ * @brief Last-known time across power loss, NTP sync tracking and boot timing.
+ */
+
+#include "boot_status.h"
+#include "monotonic_clock.h"
+#include <Preferences.h>
+#include <atomic>
+#include <sys/time.h>
+
+#include <esp_sntp.h>
+
+BootStatus bootStatus;
+
+static const time_t CLOCK_VALID_AFTER = 1704067200; // 2024-01-01 00:00 UTC
+static std::atomic<bool> timeSyncPending(false);
+
+bool isClockValid(time_t now) {
+    return now >= CLOCK_VALID_AFTER;
+}
+
+ClockSource restoreLastKnownTime() {
+    if (isClockValid(time(nullptr))) return ClockSource::Rtc;
+    Preferences prefs;
+    prefs.begin("clock", true);
+    time_t saved = (time_t)prefs.getUInt("epoch", 0);
+    prefs.end();
+    if (!isClockValid(saved)) return ClockSource::None;
+    struct timeval tv = { saved, 0 };
+    settimeofday(&tv, nullptr);
+    return ClockSource::Saved;
+}
+
+void saveLastKnownTime() {
+    time_t now = time(nullptr);
+    if (!isClockValid(now)) return;
+    Preferences prefs;
+    prefs.begin("clock", false);
+    prefs.putUInt("epoch", (uint32_t)now);
+    prefs.end();
+}
+
+static void onTimeSync(struct timeval*) {
+    timeSyncPending.store(true); // Runs in the lwIP task; loop() picks it up
+}
+
+void watchTimeSync() {
+    sntp_set_time_sync_notification_cb(onTimeSync);
+}
+
+bool takeTimeSync() {
+    return timeSyncPending.exchange(false);
+}
+
+String bootStatusToJson(uint32_t firstScheduleMs) {
+    static const char* const SOURCES[] = {"none", "rtc", "saved", "ntp"};
+    String json = "{";
+    json += "\"clockSource\":\"" + String(SOURCES[(int)bootStatus.clockSource]) + "\"";
+    json += ",\"clockValid\":" + String(isClockValid(time(nullptr)) ? "true" : "false");
+    json += ",\"accessPointMode\":" + String(bootStatus.accessPointMode ? "true" : "false");
+    json += ",\"wifiConnectedMs\":" + String(bootStatus.wifiConnectedMs);
+    json += ",\"timeSyncedMs\":" + String(bootStatus.timeSyncedMs);
+    json += ",\"firstScheduleMs\":" + String(firstScheduleMs);
+    json += ",\"uptimeMs\":" + String((uint32_t)MonotonicClock::nowMs());
+    json += "}";
+    return json;
+}
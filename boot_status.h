@@ -0,0 +1,41 @@
+#ifndef BOOT_STATUS_H
+#define BOOT_STATUS_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// Where the clock came from when the controller booted
+enum class ClockSource : uint8_t {
+    None,  // No usable time yet: the schedule waits for NTP
+    Rtc,   // Kept across a soft restart (OTA, WiFi setup)
+    Saved, // Last time saved to flash (stale by however long power was off)
+    Ntp    // Set by NTP
+};
+
+// Boot progress, reported at /boot
+struct BootStatus {
+    ClockSource clockSource = ClockSource::None;
+    bool accessPointMode = false;
+    uint32_t wifiConnectedMs = 0;  // millis() when WiFi connected (0 = not yet)
+    uint32_t timeSyncedMs = 0;     // millis() of the first NTP sync (0 = not yet)
+};
+
+extern BootStatus bootStatus;
+
+// Times before 2024-01-01 mean the clock was never set
+bool isClockValid(time_t now);
+
+// At boot: keep a valid clock, else set it from the last saved time; returns the source used
+ClockSource restoreLastKnownTime();
+// Persist the current time (if valid) so the next cold boot can start from it
+void saveLastKnownTime();
+
+// Watch for NTP syncs; call before NTP is started
+void watchTimeSync();
+// True once after each NTP sync (loop task)
+bool takeTimeSync();
+
+// Boot status and the first schedule decision as JSON
+String bootStatusToJson(uint32_t firstScheduleMs);
+
+#endif // BOOT_STATUS_H
@@ -0,0 +1,127 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Run-state changes web handlers ask the control task to make
+enum class CommandType : uint8_t {
+    RunProgramNow,    // program
+    StopProgramNow,
+    QuickRunStart,    // value = seconds per zone, program
+    QuickRunStop,
+    DisableZone,      // zone
+    EnableZone,       // zone
+    ToggleZone,       // zone (manual mode only)
+    ToggleManualMode
+};
+
+enum class CommandStatus : uint8_t {
+    Pending,   // Queued, not executed yet
+    Done,      // Executed
+    Rejected,  // Invalid for the current state (bad zone/program, not in manual mode)
+    QueueFull, // Not queued; try again
+    TimedOut   // Not executed within the wait; it still runs later
+};
+
+struct ControlCommand {
+    CommandType type;
+    int8_t zone;
+    int8_t program;
+    int32_t value;
+    uint32_t sequence; // Assigned by CommandQueue::push (never 0)
+};
+
+/**
+ * @brief Bounded lock-free queue of control commands: many producers (web
+ * handlers), one consumer (the control task).
+ *
+ * Each slot carries a turn counter, so producers claim slots with one
+ * compare-and-swap and the consumer never waits on a half-written command.
+ * Every queued command gets a sequence number; the consumer records its
+ * CommandStatus under that number and producers poll it with status().
+ */
+class CommandQueue {
+public:
+    static const uint32_t CAPACITY = 16;
+
+    CommandQueue() : _tail(0), _head(0) {
+        for (uint32_t i = 0; i < CAPACITY; i++) {
+            _slots[i].turn.store(i, std::memory_order_relaxed);
+            _results[i].sequence.store(0, std::memory_order_relaxed);
+            _results[i].status.store((uint8_t)CommandStatus::Pending, std::memory_order_relaxed);
+        }
+    }
+
+    // Queue a command (any thread); returns its sequence number, or 0 if the queue is full
+    uint32_t push(ControlCommand command) {
+        uint32_t position = _tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &_slots[position % CAPACITY];
+            int32_t lag = (int32_t)(slot->turn.load(std::memory_order_acquire) - position);
+            if (lag == 0) {
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                return 0; // Slot still holds a command from the previous lap
+            } else {
+                position = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        command.sequence = position + 1;
+        slot->command = command;
+        slot->turn.store(position + 1, std::memory_order_release);
+        return command.sequence;
+    }
+
+    // Take the oldest command (consumer only); false if none is queued
+    bool pop(ControlCommand& command) {
+        Slot& slot = _slots[_head % CAPACITY];
+        if (slot.turn.load(std::memory_order_acquire) != _head + 1) return false;
+        command = slot.command;
+        slot.turn.store(_head + CAPACITY, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    // Record the outcome of a popped command (consumer only)
+    void complete(uint32_t sequence, CommandStatus status) {
+        Result& result = _results[sequence % CAPACITY];
+        // Invalidate first, so a reader of the previous entry cannot pair its sequence with this status
+        result.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        result.status.store((uint8_t)status, std::memory_order_relaxed);
+        result.sequence.store(sequence, std::memory_order_release);
+    }
+
+    // Outcome of a queued command. Once CAPACITY later commands have completed
+    // the entry is reused and Done is reported.
+    CommandStatus status(uint32_t sequence) const {
+        const Result& result = _results[sequence % CAPACITY];
+        uint32_t recorded = result.sequence.load(std::memory_order_acquire);
+        if (recorded == sequence) {
+            CommandStatus status = (CommandStatus)result.status.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (result.sequence.load(std::memory_order_relaxed) == sequence) return status;
+            return CommandStatus::Done;
+        }
+        return (int32_t)(recorded - sequence) > 0 ? CommandStatus::Done : CommandStatus::Pending;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> turn;
+        ControlCommand command;
+    };
+    struct Result {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint8_t> status;
+    };
+
+    Slot _slots[CAPACITY];
+    Result _results[CAPACITY];
+    std::atomic<uint32_t> _tail; // Next position producers claim
+    uint32_t _head;              // Next position the consumer reads
+};
+
+#endif // COMMAND_QUEUE_H
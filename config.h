@@ -7,6 +7,9 @@
 // Configuration Constants
 #define MAX_PERIODS_PER_DAY 3
 
+// Program/zone/start-time limits
+#include "schedule_limits.h"
+
 // WiFi Credentials as mutable global Strings
 
 // Firmware Version
@@ -0,0 +1,419 @@
+/**
+ * @file control_task.cpp
+ * @brief Zone control task and the lock-free state snapshot it publishes.
+ */
+
+#include "control_task.h"
+#include "boot_status.h"
+#include "event_log.h"
+#include "latency_stats.h"
+#include "monotonic_clock.h"
+#include "wall_clock.h"
+#include "weekday.h"
+
+#include <freertos/semphr.h>
+
+// Written only by the control task (one writer), read by any web handler
+static SeqLock<ControlSnapshot> publishedSnapshot;
+// Filled by web handlers, drained only by the control task
+static CommandQueue commandQueue;
+// The running Live task, woken when a command is queued
+static std::atomic<ControlTask*> liveTask(nullptr);
+
+static SemaphoreHandle_t controlMutex() {
+    static SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();
+    return mutex;
+}
+ControlLock::ControlLock() { xSemaphoreTakeRecursive(controlMutex(), portMAX_DELAY); }
+ControlLock::~ControlLock() { xSemaphoreGiveRecursive(controlMutex()); }
+
+ControlSnapshot controlSnapshot() {
+    return publishedSnapshot.read();
+}
+
+uint32_t submitControlCommand(const ControlCommand& command) {
+    uint32_t sequence = commandQueue.push(command);
+    // Do not wait out a stretched (idle) period
+    ControlTask* task = liveTask.load();
+    if (sequence != 0 && task) task->wake();
+    return sequence;
+}
+
+CommandStatus controlCommandStatus(uint32_t sequence) {
+    return commandQueue.status(sequence);
+}
+
+CommandStatus runControlCommand(CommandType type, int zone, int program, int32_t value, uint32_t timeoutMs) {
+    ControlCommand command = {};
+    command.type = type;
+    command.zone = zone;
+    command.program = program;
+    command.value = value;
+    uint32_t sequence = submitControlCommand(command);
+    if (sequence == 0) return CommandStatus::QueueFull;
+    unsigned long start = millis();
+    for (;;) {
+        CommandStatus status = controlCommandStatus(sequence);
+        if (status != CommandStatus::Pending) return status;
+        if (millis() - start >= timeoutMs) return CommandStatus::TimedOut;
+        delay(1);
+    }
+}
+
+ControlTask::ControlTask(ScheduleManager& scheduleManager, SprinklerSystemState& manualState, SprinklerController& controller,
+                         Mode mode)
+    : _scheduleManager(scheduleManager), _manualState(manualState), _controller(controller), _mode(mode), _running(false), _periodMs(PERIOD_MS),
+      _transitionTimer(onTransitionDue, this),
+      _schedulePassProbe(mode == Mode::Live ? latencyStats.probe("control: schedule pass") : nullptr),
+      _relayPassProbe(mode == Mode::Live ? latencyStats.probe("control: relay pass") : nullptr) {
+    if (_mode == Mode::Simulation) {
+        _scheduleManager.runs.hold(RunSource::Schedule, 0);
+        return;
+    }
+    ControlLock lock;
+    _scheduleManager.runs.hold(RunSource::Schedule, 0); // Filled in by the first schedule pass
+    if (_manualState.isManualMode()) _scheduleManager.runs.hold(RunSource::Manual, 0);
+    publishSnapshot();
+}
+
+ControlTask::~ControlTask() {
+    end();
+}
+
+void ControlTask::begin() {
+    if (_running.exchange(true)) return;
+    // Pin to the core loop() (web server, OTA) is not running on
+#if portNUM_PROCESSORS > 1
+    BaseType_t core = 1 - xPortGetCoreID();
+#else
+    BaseType_t core = 0;
+#endif
+    _transitionTimer.begin(); // Live only: a Simulation-mode task never creates the esp_timer
+    xTaskCreatePinnedToCore(taskMain, "zone_control", STACK_SIZE, this, PRIORITY, &_handle, core);
+    liveTask.store(this);
+}
+
+void ControlTask::end() {
+    if (!_running.exchange(false)) return;
+    liveTask.store(nullptr);
+    ControlLock lock;  // Not in the middle of a pass
+    vTaskDelete(_handle);
+    _handle = nullptr;
+    _transitionTimer.cancel();
+    _transitionArmed = false;
+}
+
+void ControlTask::wake() {
+    TaskHandle_t handle = _handle;
+    if (handle) xTaskNotifyGive(handle);
+}
+
+void ControlTask::taskMain(void* arg) {
+    ControlTask* task = static_cast<ControlTask*>(arg);
+    for (;;) {
+        task->step();
+        // Sleep one period, or until the transition timer (or wake()) says a switch is due
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(task->periodMs()));
+    }
+}
+
+void ControlTask::onTransitionDue(void* arg) {
+    static_cast<ControlTask*>(arg)->wake();
+}
+
+void ControlTask::step() {
+    if (_mode == Mode::Simulation) {
+        runPass(); // Private state on simulated time: nothing to lock, queue or publish
+        return;
+    }
+    ControlLock lock;
+    // Queued commands first, so this pass already acts on them
+    uint32_t sequences[CommandQueue::CAPACITY];
+    CommandStatus statuses[CommandQueue::CAPACITY];
+    uint32_t executed = 0;
+    ControlCommand command;
+    while (executed < CommandQueue::CAPACITY && commandQueue.pop(command)) {
+        sequences[executed] = command.sequence;
+        statuses[executed] = execute(command);
+        executed++;
+    }
+    uint64_t nowMs = MonotonicClock::nowMs();
+    if (_transitionArmed && nowMs >= _transitionAt) {
+        // This pass makes the armed switch
+        uint64_t lateMs = nowMs - _transitionAt;
+        _scheduleManager.runTransitionJitter.record(lateMs > UINT32_MAX ? UINT32_MAX : (uint32_t)lateMs);
+        _transitionArmed = false;
+    }
+    runPass();
+    publishSnapshot();
+    armRunTransition();
+    // Report completion once the snapshot shows the result
+    for (uint32_t i = 0; i < executed; i++) {
+        commandQueue.complete(sequences[i], statuses[i]);
+    }
+}
+
+// Point the transition timer at the next Quick Run / Run Program Now switch
+void ControlTask::armRunTransition() {
+    uint64_t at;
+    if (!_scheduleManager.nextRunTransition(at)) {
+        if (_transitionArmed) _transitionTimer.cancel();
+        _transitionArmed = false;
+        return;
+    }
+    if (_transitionArmed && at == _transitionAt) return;
+    _transitionArmed = true;
+    _transitionAt = at;
+    // Fire at the exact microsecond nowMs() reaches the deadline, so only the part of a
+    // millisecond the clock had not yet reached when arming is added
+    uint64_t nowUs = MonotonicClock::nowMicros();
+    uint64_t atUs = at * 1000;
+    _transitionTimer.armInMicros(atUs > nowUs ? atUs - nowUs : 0);
+}
+
+CommandStatus ControlTask::execute(const ControlCommand& command) {
+    RunArbiter& runs = _scheduleManager.runs;
+    bool validZone = command.zone >= 0 && command.zone < _scheduleManager.count;
+    switch (command.type) {
+    case CommandType::RunProgramNow:
+        if (!ScheduleManager::isValidProgramIndex(command.program)) return CommandStatus::Rejected;
+        if (!_scheduleManager.startRunProgramNow(command.program)) return CommandStatus::Rejected;
+        // It moves the program's first start time to now
+        _scheduleManager.requestScheduleCheck();
+        break;
+    case CommandType::StopProgramNow:
+        _scheduleManager.stopRunProgramNow();
+        break;
+    case CommandType::QuickRunStart:
+        if (!ScheduleManager::isValidProgramIndex(command.program)) return CommandStatus::Rejected;
+        _scheduleManager.startQuickRun(command.value > 0 ? (uint32_t)command.value : 0, command.program);
+        if (!_scheduleManager.isQuickRunActive()) return CommandStatus::Rejected; // No zone to run
+        break;
+    case CommandType::QuickRunStop:
+        _scheduleManager.stopQuickRun();
+        break;
+    case CommandType::DisableZone:
+    case CommandType::EnableZone:
+        if (!validZone) return CommandStatus::Rejected;
+        // The relay pass right after closes it, or opens it if its run wants it
+        _scheduleManager.sprinklers[command.zone].disabled = command.type == CommandType::DisableZone;
+        break;
+    case CommandType::ToggleZone:
+        if (!validZone || !runs.isActive(RunSource::Manual)) return CommandStatus::Rejected;
+        runs.hold(RunSource::Manual, runs.heldZones(RunSource::Manual) ^ (1UL << command.zone));
+        break;
+    case CommandType::ToggleManualMode:
+        // Manual mode starts with every zone off
+        if (runs.isActive(RunSource::Manual)) {
+            runs.stop(RunSource::Manual);
+        } else {
+            runs.hold(RunSource::Manual, 0);
+        }
+        _manualState.setManualMode(runs.isActive(RunSource::Manual));
+        break;
+    default:
+        return CommandStatus::Rejected;
+    }
+    return CommandStatus::Done;
+}
+
+// One relay pass for whichever run is in control (priorities and preemption in RunArbiter)
+void ControlTask::runPass() {
+    {
+        ScopedLatency timer(_schedulePassProbe);
+        runSchedulePass();
+    }
+
+    ScopedLatency timer(_relayPassProbe);
+    uint64_t nowMs = MonotonicClock::nowMs();
+    RunArbiter& runs = _scheduleManager.runs;
+    runs.advance(nowMs);
+    uint32_t zones = runs.zoneMask(nowMs);
+    for (int i = 0; i < _scheduleManager.count; i++) {
+        Sprinkler& sprinkler = _scheduleManager.sprinklers[i];
+        bool shouldBeOn = ((zones >> i) & 1) && !sprinkler.disabled;
+        if (!shouldBeOn) zones &= ~(1UL << i);
+        if (sprinkler.state != shouldBeOn) {
+            sprinkler.state = shouldBeOn;
+            LOG_INFO("Sprinkler %d turned %s", i + 1, shouldBeOn ? "ON" : "OFF");
+        }
+    }
+    // Writes only the relays that changed since the last pass
+    _controller.applyZoneMask(zones);
+    bool anyActive = zones != 0;
+
+    // Blink the LED while any sprinkler is on
+    if (anyActive) {
+        if (nowMs - _lastBlink >= 500) {
+            _ledState = !_ledState;
+            _controller.setStatusLed(_ledState);
+            _lastBlink = nowMs;
+        }
+    } else if (_ledState) {
+        _ledState = false;
+        _controller.setStatusLed(false);
+    }
+}
+
+// Keeps the Schedule run's zone mask current; the other runs do not stop it
+void ControlTask::runSchedulePass() {
+    // --- EVENT-DRIVEN SCHEDULE PASS ---
+    // Runs only when the armed transition deadline (next zone start/end or midnight)
+    // is reached, or when programs, zones or the clock changed. Between events the
+    // pass does no schedule work at all.
+    int64_t nowMs = WallClock::nowMs();
+    time_t nowEpoch = (time_t)(nowMs / 1000);
+    if (!isClockValid(nowEpoch)) {
+        // Cold boot without a saved time: no schedule until NTP sets the clock
+        _scheduleManager.requestScheduleCheck();
+        return;
+    }
+    // A step either way (NTP correcting a time restored from flash, a manual set) can land on
+    // another date with the same weekday: rebuild the schedule for whatever date it is now
+    uint64_t monotonicMs = MonotonicClock::nowMs();
+    if (_lastWallMs != 0) {
+        int64_t drift = (nowMs - _lastWallMs) - (int64_t)(monotonicMs - _lastMonotonicMs);
+        if (drift > (int64_t)CLOCK_STEP_MS || drift < -(int64_t)CLOCK_STEP_MS) {
+            LOG_INFO("Clock stepped by %ld s, rebuilding the schedule", (long)(drift / 1000));
+            _lastEpochDay = INT32_MIN;
+            _scheduleManager.requestScheduleCheck();
+        }
+    }
+    _lastWallMs = nowMs;
+    _lastMonotonicMs = monotonicMs;
+    if (nowEpoch < _lastSchedulePass) {
+        _scheduleManager.requestScheduleCheck(); // Clock stepped backwards (NTP/timezone)
+    }
+    if (_scheduleManager.isScheduleCheckDue(nowEpoch)) {
+        if (!_scheduleManager.scheduleCheckPending) {
+            // Deadline-triggered pass: record requested vs actual transition time
+            _scheduleManager.recordTransitionLatency(nowMs);
+        }
+        time_t now = nowEpoch;
+        struct tm timeinfo;
+        localtime_r(&now, &timeinfo);
+        _lastSchedulePass = now;
+
+        // Convert to our day indexing (0=Monday to 6=Sunday)
+        int systemDay = timeinfo.tm_wday; // 0=Sunday in system
+        int ourDay = (systemDay == 0) ? 6 : systemDay - 1; // Convert to our format
+
+        LOG_DEBUG("--------- SCHEDULE DIAGNOSTICS ---------");
+        LOG_DEBUG("Current date/time: %04d-%02d-%02d %02d:%02d:%02d",
+                  timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+                  timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+        LOG_DEBUG("Day of Week: %d (System), %d (Our format, 0=Mon)", systemDay, ourDay);
+        LOG_DEBUG("Day Name: %s", WeekdayUtils::name((Weekday)ourDay));
+
+        // Calculate minutes since midnight
+        int currentMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+        LOG_DEBUG("Minutes since midnight: %d", currentMinutes);
+
+        // Today's schedules, including yesterday's runs that carry past midnight
+        LOG_DEBUG("Today's schedules:");
+        const ScheduleTable& table = _scheduleManager.activeSchedule();
+        for (int i = 0; i < _scheduleManager.count; i++) {
+            const ZoneInterval* intervals = table.zoneIntervals(i);
+            for (int k = 0; k < table.zoneIntervalCount(i); k++) {
+                const ZoneInterval &schedule = intervals[k];
+                if (schedule.endMinute <= ScheduleManager::HORIZON_TODAY) continue;
+                int startMinute = schedule.startMinute % 1440;
+                LOG_DEBUG("  Zone %d program %c: %s%02d:%02d - %02d:%02d", i + 1,
+                          programLetter(schedule.programIndex),
+                          schedule.startMinute < ScheduleManager::HORIZON_TODAY ? "yesterday " : "",
+                          startMinute / 60, startMinute % 60,
+                          (schedule.endMinute / 60) % 24, schedule.endMinute % 60);
+            }
+        }
+
+        int currentHour = timeinfo.tm_hour;
+        int currentMinute = timeinfo.tm_min;
+
+        // Get current weekday (0 = Monday)
+        int today = (timeinfo.tm_wday + 6) % 7;
+
+        LOG_DEBUG("Checking schedules at %02d:%02d on %s (Day %d)",
+                  currentHour, currentMinute, WeekdayUtils::name((Weekday)today), today);
+
+        // Compare dates, not weekdays: a clock step may move to the same weekday of another week
+        int32_t epochDay = epochDayFromTm(timeinfo);
+        if (epochDay != _lastEpochDay) {
+            // Day has changed: publish the prepared schedule (or build it if programs changed)
+            LOG_INFO("New day detected, recalculating schedules");
+            // Days are laid out with their own month's budget: a new month changes nothing already built
+            _scheduleManager.updateWaterBudget(timeinfo.tm_mon);
+            // A new week leaves the occupancy index stale; loop() rebuilds it in idle time,
+            // relays follow the schedule table published below
+            _scheduleManager.setScheduleDate(epochDay);
+            _scheduleManager.calculateZoneSchedules(today);
+            _lastEpochDay = epochDay;
+            int dropped = _scheduleManager.activeSchedule().dropped();
+            if (dropped > 0) LOG_WARN("Schedule table full: %d runs dropped (raise SCHEDULE_TABLE_CAPACITY)", dropped);
+        }
+
+        // Zones the published schedule table has on now
+        uint32_t scheduled = 0;
+        for (int i = 0; i < _scheduleManager.count; i++) {
+            if (_scheduleManager.checkSprinklerSchedule(i, currentHour, currentMinute)) {
+                scheduled |= 1UL << i;
+            }
+        }
+        if (scheduled != _scheduleManager.runs.heldZones(RunSource::Schedule)) {
+            LOG_INFO("Scheduled zones changed to 0x%08lx", (unsigned long)scheduled);
+        }
+        _scheduleManager.runs.hold(RunSource::Schedule, scheduled);
+        if (_firstScheduleMs == 0) {
+            _firstScheduleMs = (uint32_t)MonotonicClock::nowMs();
+            if (_firstScheduleMs == 0) _firstScheduleMs = 1;
+            LOG_INFO("First schedule decision %lu ms after boot", (unsigned long)_firstScheduleMs);
+        }
+
+        // Arm the deadline for the next start/end boundary
+        _scheduleManager.armNextTransition(timeinfo);
+        struct tm nextInfo;
+        localtime_r(&_scheduleManager.nextTransitionTime, &nextInfo);
+        LOG_DEBUG("Next schedule transition at %02d:%02d (last latency %ld ms)",
+                  nextInfo.tm_hour, nextInfo.tm_min,
+                  (long)_scheduleManager.transitionStats.lastLatencyMs);
+    }
+}
+
+// Copy the zone and run state into the snapshot web handlers read
+void ControlTask::publishSnapshot() {
+    const RunArbiter& runs = _scheduleManager.runs;
+    ControlSnapshot snapshot = {};
+    snapshot.passes = ++_passes;
+    snapshot.activeZone = -1;
+    snapshot.activeProgram = -1;
+    snapshot.runProgramNowIndex = runs.program(RunSource::RunProgramNow);
+    int quickRunSegment = runs.currentSegment(RunSource::QuickRun, MonotonicClock::nowMs());
+    snapshot.quickRunZone = quickRunSegment >= 0 ? runs.segment(RunSource::QuickRun, quickRunSegment).zone : -1;
+    snapshot.scheduledMask = runs.heldZones(RunSource::Schedule);
+    snapshot.manualMode = _manualState.isManualMode();
+    snapshot.relayWrites = _controller.physicalWrites();
+    snapshot.firstScheduleMs = _firstScheduleMs;
+
+    for (int i = 0; i < _scheduleManager.count; i++) {
+        const Sprinkler& sprinkler = _scheduleManager.sprinklers[i];
+        if (sprinkler.disabled) snapshot.zoneDisabledMask |= 1UL << i;
+        if (!sprinkler.state) continue;
+        snapshot.zoneOnMask |= 1UL << i;
+        snapshot.activeZone = i;
+    }
+
+    // Which program is running the active zone
+    if (snapshot.activeZone >= 0) {
+        RunSource owner = runs.owner();
+        if (owner == RunSource::Schedule) {
+            struct tm timeinfo;
+            WallClock::localNow(timeinfo);
+            int minute = ScheduleManager::HORIZON_TODAY + timeinfo.tm_hour * 60 + timeinfo.tm_min;
+            const ScheduleTable& table = _scheduleManager.activeSchedule();
+            int interval = table.findInterval(snapshot.activeZone, minute);
+            if (interval >= 0) snapshot.activeProgram = table.zoneIntervals(snapshot.activeZone)[interval].programIndex;
+        } else if (owner != RunSource::COUNT) {
+            snapshot.activeProgram = runs.program(owner); // Run Program Now, Quick Run (-1 for manual)
+        }
+    }
+    publishedSnapshot.write(snapshot);
+}
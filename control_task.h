@@ -0,0 +1,137 @@
+#ifndef CONTROL_TASK_H
+#define CONTROL_TASK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "command_queue.h"
+#include "latency_stats.h"
+#include "schedule.h"
+#include "seqlock.h"
+#include "sprinkler_controller.h"
+#include "sprinkler_system_state.h"
+#include "transition_timer.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Zone and run state published by the control task after every pass
+struct ControlSnapshot {
+    uint32_t passes;           // Control passes completed
+    uint32_t zoneOnMask;       // Bit z: zone z relay on
+    uint32_t zoneDisabledMask; // Bit z: zone z disabled
+    uint32_t scheduledMask;    // Bit z: zone z inside a scheduled run right now
+    int8_t activeZone;         // Highest zone that is on, or -1
+    int8_t activeProgram;      // Program running activeZone (Run Program Now, Quick Run or schedule), or -1
+    int8_t runProgramNowIndex; // Program of an active Run Program Now, or -1
+    int8_t quickRunZone;       // Zone of an active Quick Run, or -1
+    bool manualMode;
+    uint32_t relayWrites;      // Relay pin / GPIO register writes since boot
+    uint32_t firstScheduleMs;  // millis() of the first schedule decision with a valid clock (0 = not yet)
+};
+
+/**
+ * @brief Runs zone control (Run Program Now, Quick Run, manual mode and the
+ * event-driven schedule pass) in its own task, apart from the web server.
+ *
+ * This is a FreeRTOS task pinned to the core loop() does not run on, at a
+ * higher priority, so page renders and OTA uploads cannot delay zone
+ * transitions. Each pass first executes the commands web handlers queued with
+ * submitControlCommand(), then runs under ControlLock and publishes a
+ * ControlSnapshot that web handlers read with controlSnapshot() without
+ * blocking. Commands are reported complete only after that snapshot is out.
+ *
+ * Quick Run and Run Program Now zone changes do not wait for the next
+ * period: a TransitionTimer is armed for the next one and wakes the task
+ * when it is due. How late each switch happened is kept in
+ * ScheduleManager::runTransitionJitter.
+ *
+ * In Simulation mode the object is driven only by step() from the calling
+ * thread, against its own ScheduleManager and controller: no command queue,
+ * snapshot, transition timer, ControlLock or latency probes, so a
+ * fast-forward run next to the live task leaves the live state alone.
+ */
+class ControlTask {
+public:
+    static const uint32_t PERIOD_MS = 5;       // Time between control passes (default)
+    static const uint32_t STACK_SIZE = 8192;   // Bytes (FreeRTOS task stack)
+    static const int PRIORITY = 5;             // FreeRTOS priority (loop() runs at 1)
+    static const uint32_t COMMAND_TIMEOUT_MS = 500; // Default wait for a queued command
+    static const uint32_t CLOCK_STEP_MS = 2000;      // Wall clock moving this far from monotonic time is a step
+
+    enum class Mode : uint8_t {
+        Live,       // The controller's task: commands, snapshots, transition timer
+        Simulation  // Stepped by the caller on WallClock/MonotonicClock simulated time
+    };
+
+    ControlTask(ScheduleManager& scheduleManager, SprinklerSystemState& manualState, SprinklerController& controller,
+                Mode mode = Mode::Live);
+    ~ControlTask();
+    void begin();   // Start the task; passes run every PERIOD_MS from now on
+    void end();     // Stop the task (waits for the current pass)
+    void step();    // One control pass and snapshot publish (what the task runs)
+    bool isRunning() const { return _running.load(); }
+    void wake();    // Run a pass now instead of at the end of the period (any task)
+    // Time between passes while nothing wakes the task (the power policy stretches it when idle);
+    // queued commands and the transition timer still wake it at once
+    void setPeriodMs(uint32_t periodMs) { _periodMs.store(periodMs ? periodMs : PERIOD_MS); }
+    uint32_t periodMs() const { return _periodMs.load(); }
+
+private:
+    CommandStatus execute(const ControlCommand& command);
+    void runPass();
+    void runSchedulePass();
+    void publishSnapshot();
+    void armRunTransition();
+    static void onTransitionDue(void* arg);
+
+    ScheduleManager& _scheduleManager;
+    SprinklerSystemState& _manualState;
+    SprinklerController& _controller;
+    Mode _mode;
+    std::atomic<bool> _running;
+    std::atomic<uint32_t> _periodMs;
+    uint32_t _passes = 0;
+    time_t _lastSchedulePass = 0;
+    int32_t _lastEpochDay = INT32_MIN;   // Date the schedule was last built for (INT32_MIN = rebuild)
+    int64_t _lastWallMs = 0;             // WallClock and MonotonicClock at the previous pass, to spot clock steps
+    uint64_t _lastMonotonicMs = 0;
+    uint32_t _firstScheduleMs = 0;
+    uint64_t _lastBlink = 0;
+    bool _ledState = false;
+    TransitionTimer _transitionTimer;
+    bool _transitionArmed = false;
+    uint64_t _transitionAt = 0;          // MonotonicClock time of the armed Quick Run / Run Program Now switch
+    LatencyProbe* _schedulePassProbe;    // Time spent in runSchedulePass()
+    LatencyProbe* _relayPassProbe;       // Time spent arbitrating runs and writing relays
+    static void taskMain(void* arg);
+    TaskHandle_t _handle = nullptr;
+};
+
+/**
+ * @brief Scoped lock serializing changes to shared schedule and zone state.
+ *
+ * The control task holds it for each pass; web handlers hold it while they
+ * edit programs or read schedule state (not while they send the response).
+ * Run-state changes go through the command queue instead.
+ * Recursive, so nested helpers may lock again.
+ */
+class ControlLock {
+public:
+    ControlLock();
+    ~ControlLock();
+    ControlLock(const ControlLock&) = delete;
+    ControlLock& operator=(const ControlLock&) = delete;
+};
+
+// Latest state published by the control task; never blocks
+ControlSnapshot controlSnapshot();
+
+// Queue a command for the control task; returns its sequence number, or 0 if the queue is full
+uint32_t submitControlCommand(const ControlCommand& command);
+// Outcome of a queued command (Pending until the control task has run it)
+CommandStatus controlCommandStatus(uint32_t sequence);
+// Queue a command and wait up to timeoutMs for the control task to run it
+CommandStatus runControlCommand(CommandType type, int zone = -1, int program = -1, int32_t value = 0,
+                                uint32_t timeoutMs = ControlTask::COMMAND_TIMEOUT_MS);
+
+#endif // CONTROL_TASK_H
@@ -0,0 +1,188 @@
+/**
+ * @file deep_sleep.cpp
+ * @brief Deep sleep until the next program start, with the plan kept in RTC memory.
+ */
+
+#include "deep_sleep.h"
+#include "boot_status.h"
+#include <Preferences.h>
+
+#include <esp_attr.h>
+#include <esp_sleep.h>
+
+DeepSleep deepSleep;
+
+static const uint32_t RECORD_MAGIC = 0x534C5031; // "SLP1"
+
+// Survives deep sleep; garbage after power-on (checked with RECORD_MAGIC)
+RTC_DATA_ATTR static DeepSleepRecord rtcRecord;
+
+// Local wall time of a minute of an epoch day
+static time_t localTimeOf(int32_t epochDay, int minuteOfDay) {
+    int year, month, day;
+    civilFromEpochDay(epochDay, year, month, day);
+    struct tm t = {};
+    t.tm_year = year - 1900;
+    t.tm_mon = month - 1;
+    t.tm_mday = day;
+    t.tm_min = minuteOfDay; // mktime() normalizes to hours
+    t.tm_isdst = -1;
+    return mktime(&t);
+}
+
+bool nextProgramStart(const ScheduleManager& scheduleManager, time_t after, time_t& startAt, int& program) {
+    struct tm local;
+    localtime_r(&after, &local);
+    int32_t today = epochDayFromTm(local);
+    bool found = false;
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        const Program& candidate = scheduleManager.programs[p];
+        if (!candidate.enabled || scheduleManager.programZoneMask(p) == 0) continue;
+        // Today's starts may all be past: the next run day then has the answer
+        int32_t runDays[2];
+        int numDays = forecastRunDays(candidate, today, runDays, 2);
+        for (int d = 0; d < numDays; d++) {
+            for (int k = 0; k < MAX_START_TIMES; k++) {
+                if (candidate.startTimes[k] == NO_START_TIME) continue;
+                time_t at = localTimeOf(runDays[d], candidate.startTimes[k]);
+                if (at <= after || (found && at >= startAt)) continue;
+                startAt = at;
+                program = p;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+void DeepSleep::begin() {
+    Preferences prefs;
+    prefs.begin("power", true);
+    _enabled = prefs.getBool("deepSleep", false);
+    prefs.end();
+    if (rtcRecord.magic != RECORD_MAGIC) {
+        rtcRecord = _record; // Power-on: start a fresh record
+        rtcRecord.magic = RECORD_MAGIC;
+    }
+    _record = rtcRecord;
+    wake(esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER, 0);
+}
+
+void DeepSleep::setEnabled(bool enabled) {
+    _enabled = enabled;
+    Preferences prefs;
+    prefs.begin("power", false);
+    prefs.putBool("deepSleep", enabled);
+    prefs.end();
+}
+
+bool DeepSleep::timeSyncDue(time_t now) const {
+    return _record.lastTimeSync == 0 || now - _record.lastTimeSync >= (time_t)TIME_SYNC_INTERVAL_S;
+}
+
+DeepSleepPlan DeepSleep::plan(const ScheduleManager& scheduleManager, time_t now, uint64_t awakeMs,
+                              uint64_t quietMs, bool busy) const {
+    DeepSleepPlan result = {false, 0, 0, -1};
+    if (busy || !isClockValid(now) || scheduleManager.scheduleCheckPending) return result;
+    if (!_scheduledWake && awakeMs < AWAKE_AFTER_BOOT_MS) return result;
+    if (quietMs < QUIET_BEFORE_SLEEP_MS) return result;
+
+    // Today's schedule: a run going on now, or the next zone start (cycles after a soak too)
+    struct tm local;
+    localtime_r(&now, &local);
+    int minute = ScheduleManager::HORIZON_TODAY + local.tm_hour * 60 + local.tm_min;
+    const ScheduleTable& table = scheduleManager.activeSchedule();
+    int nextMinute = -1;
+    int program = -1;
+    for (int z = 0; z < scheduleManager.count; z++) {
+        const ZoneInterval* intervals = table.zoneIntervals(z);
+        for (int k = 0; k < table.zoneIntervalCount(z); k++) {
+            if (intervals[k].endMinute <= minute) continue;
+            if (intervals[k].startMinute <= minute) return result; // Running now
+            if (nextMinute < 0 || intervals[k].startMinute < nextMinute) {
+                nextMinute = intervals[k].startMinute;
+                program = intervals[k].programIndex;
+            }
+        }
+    }
+    time_t eventAt = 0;
+    if (nextMinute >= 0) {
+        struct tm at = local;
+        at.tm_hour = 0;
+        at.tm_min = nextMinute - ScheduleManager::HORIZON_TODAY;
+        at.tm_sec = 0;
+        at.tm_isdst = -1;
+        eventAt = mktime(&at);
+    }
+    // Later days: straight from the program definitions
+    time_t startAt;
+    int startProgram;
+    if (nextProgramStart(scheduleManager, now, startAt, startProgram) && (eventAt == 0 || startAt < eventAt)) {
+        eventAt = startAt;
+        program = startProgram;
+    }
+
+    time_t wakeAt = now + (time_t)MAX_SLEEP_S;
+    if (eventAt != 0 && eventAt - (time_t)WAKE_LEAD_S < wakeAt) {
+        wakeAt = eventAt - (time_t)WAKE_LEAD_S;
+    } else {
+        eventAt = 0; // Nothing before the longest sleep: wake to re-plan
+        program = -1;
+    }
+    if (wakeAt - now < (time_t)MIN_SLEEP_S) return result;
+    result.sleep = true;
+    result.wakeAt = wakeAt;
+    result.eventAt = eventAt;
+    result.program = program;
+    return result;
+}
+
+void DeepSleep::noteZones(uint32_t zoneMask, uint64_t nowMs, int64_t wallMs) {
+    if (!_awaitingRelay || zoneMask == 0) return;
+    _awaitingRelay = false;
+    uint64_t elapsed = nowMs > _wokeAtMs ? nowMs - _wokeAtMs : 0;
+    _record.lastWakeToRelayMs = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    if (_record.lastWakeToRelayMs > _record.maxWakeToRelayMs) _record.maxWakeToRelayMs = _record.lastWakeToRelayMs;
+    _record.lastRelayLateMs = (int32_t)(wallMs - _record.eventAt * 1000);
+    if (_record.lastRelayLateMs > _record.maxRelayLateMs) _record.maxRelayLateMs = _record.lastRelayLateMs;
+}
+
+void DeepSleep::noteSleep(const DeepSleepPlan& plan) {
+    _record.sleeps++;
+    _record.eventAt = plan.eventAt;
+    _record.program = (int8_t)plan.program;
+    _awaitingRelay = false;
+}
+
+void DeepSleep::sleep(const DeepSleepPlan& plan, time_t now, SprinklerController& controller) {
+    controller.applyZoneMask(0);
+    noteSleep(plan);
+    controller.holdOutputs(true); // Relays stay off while the chip sleeps and boots
+    rtcRecord = _record;
+    uint64_t sleepS = plan.wakeAt > now ? (uint64_t)(plan.wakeAt - now) : 1;
+    esp_sleep_enable_timer_wakeup(sleepS * 1000000ULL);
+    esp_deep_sleep_start();
+}
+
+void DeepSleep::wake(bool scheduled, uint64_t nowMs) {
+    _scheduledWake = scheduled;
+    _wokeAtMs = nowMs;
+    _awaitingRelay = scheduled && _record.eventAt != 0;
+}
+
+String DeepSleep::toJson(time_t now, time_t nextStart, int nextProgram) const {
+    String json = "{";
+    json += "\"enabled\":" + String(_enabled ? "true" : "false");
+    json += ",\"scheduledWake\":" + String(_scheduledWake ? "true" : "false");
+    json += ",\"sleeps\":" + String(_record.sleeps);
+    json += ",\"timeSyncDue\":" + String(timeSyncDue(now) ? "true" : "false");
+    json += ",\"lastTimeSync\":" + String((long)_record.lastTimeSync);
+    json += ",\"nextProgramStart\":" + String((long)nextStart);
+    json += ",\"nextProgram\":" + String(nextProgram);
+    json += ",\"lastWakeToRelayMs\":" + String(_record.lastWakeToRelayMs);
+    json += ",\"maxWakeToRelayMs\":" + String(_record.maxWakeToRelayMs);
+    json += ",\"lastRelayLateMs\":" + String((long)_record.lastRelayLateMs);
+    json += ",\"maxRelayLateMs\":" + String((long)_record.maxRelayLateMs);
+    json += "}";
+    return json;
+}
@@ -0,0 +1,93 @@
+#ifndef DEEP_SLEEP_H
+#define DEEP_SLEEP_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "schedule.h"
+#include "sprinkler_controller.h"
+
+// Kept in RTC memory across deep sleep (cleared at power-on)
+struct DeepSleepRecord {
+    uint32_t magic;
+    uint32_t sleeps;             // Deep sleeps since power-on
+    int64_t eventAt;             // Program start the next wake is for (0 = wake only to re-plan)
+    int64_t lastTimeSync;        // Wall time of the last NTP sync (0 = none since power-on)
+    uint32_t lastWakeToRelayMs;  // Wake (app start) to the first relay on, last scheduled wake
+    uint32_t maxWakeToRelayMs;
+    int32_t lastRelayLateMs;     // First relay on vs the program start it woke for
+    int32_t maxRelayLateMs;
+    int8_t program;              // Program of eventAt, or -1
+};
+
+// Whether to deep-sleep now, and until when
+struct DeepSleepPlan {
+    bool sleep;
+    time_t wakeAt;               // Wall time to wake
+    time_t eventAt;              // Program start to wake for (0 = none before MAX_SLEEP_S)
+    int program;                 // Program of eventAt, or -1
+};
+
+// Next start of an enabled program after `after`, from programs[] (recurrence and start times);
+// false if no program waters any zone
+bool nextProgramStart(const ScheduleManager& scheduleManager, time_t after, time_t& startAt, int& program);
+
+/**
+ * @brief Deep sleep between waterings for battery or solar controllers.
+ *
+ * When enabled (and nothing is running, the web interface is quiet and no
+ * run of today's schedule is still ahead within MIN_SLEEP_S), loop() asks
+ * plan() when the next program starts, then sleep() switches every relay
+ * off, holds the relay pins, keeps the plan in RTC memory and deep-sleeps
+ * on the RTC timer until WAKE_LEAD_S before that start. The RTC keeps the
+ * clock, so a timer wake boots straight into the schedule without WiFi,
+ * NTP or the web server (unless a time sync is due), waters, and goes back
+ * to sleep. How long the relay took after the wake, and how late it was
+ * against the program start, are kept in the record.
+ *
+ * plan() only reads its inputs, and noteSleep() / wake() only update the
+ * record, so runDeepSleepSimulation() replays the sleep/wake sequence on a
+ * private object without touching the chip.
+ */
+class DeepSleep {
+public:
+    static const uint32_t WAKE_LEAD_S = 5;                  // Wake this long before a program start
+    static const uint32_t MIN_SLEEP_S = 60;                 // Stay awake for shorter gaps
+    static const uint32_t MAX_SLEEP_S = 6UL * 3600;         // Longest sleep (then wake to re-plan)
+    static const uint32_t AWAKE_AFTER_BOOT_MS = 300000;     // After power-on or reset, time to reach the web interface
+    static const uint32_t QUIET_BEFORE_SLEEP_MS = 60000;    // No web request or OTA packet for this long
+    static const uint32_t TIME_SYNC_INTERVAL_S = 86400;     // Bring WiFi up for NTP on a wake after this long
+    static const uint32_t TIME_SYNC_TIMEOUT_MS = 30000;     // Give up on that sync after this long awake
+
+    void begin();                // Load the setting, read the wake cause and the RTC record
+    bool isEnabled() const { return _enabled; }
+    void setEnabled(bool enabled);  // Saved to flash
+    bool isScheduledWake() const { return _scheduledWake; }
+    bool timeSyncDue(time_t now) const;
+    void noteTimeSync(time_t now) { _record.lastTimeSync = now; }
+
+    // busy: zones on, a timed or manual run, or the network still coming up
+    DeepSleepPlan plan(const ScheduleManager& scheduleManager, time_t now, uint64_t awakeMs,
+                       uint64_t quietMs, bool busy) const;
+    // Relays now on (bit z = zone z); measures the first one after a scheduled wake
+    void noteZones(uint32_t zoneMask, uint64_t nowMs, int64_t wallMs);
+    // Relays off, pins held, RTC timer set: does not return
+    void sleep(const DeepSleepPlan& plan, time_t now, SprinklerController& controller);
+    // Count a sleep for plan in the record, without touching the hardware (sleep(); simulation)
+    void noteSleep(const DeepSleepPlan& plan);
+    // Start of an awake period (begin() after a boot; the simulation after each sleep)
+    void wake(bool scheduled, uint64_t nowMs);
+
+    const DeepSleepRecord& record() const { return _record; }
+    String toJson(time_t now, time_t nextStart, int nextProgram) const;
+
+private:
+    bool _enabled = false;
+    bool _scheduledWake = false;
+    bool _awaitingRelay = false;
+    uint64_t _wokeAtMs = 0;
+    DeepSleepRecord _record = {0, 0, 0, 0, 0, 0, 0, 0, -1};
+};
+
+extern DeepSleep deepSleep;
+
+#endif // DEEP_SLEEP_H
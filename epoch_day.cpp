@@ -0,0 +1,38 @@
+/**
+ * @file epoch_day.cpp
+ * @brief Closed-form conversions between calendar dates and epoch day numbers.
+ *
+ * Uses the era-based (400-year cycle) algorithm, so no loops over years or months.
+ */
+
+#include "epoch_day.h"
+
+int32_t epochDayFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const int32_t yearOfEra = year - era * 400;                                    // [0, 399]
+    const int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1; // [0, 365], March-based
+    const int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void civilFromEpochDay(int32_t epochDay, int& year, int& month, int& day) {
+    epochDay += 719468;
+    const int32_t era = (epochDay >= 0 ? epochDay : epochDay - 146096) / 146097;
+    const int32_t dayOfEra = epochDay - era * 146097;                                         // [0, 146096]
+    const int32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100); // [0, 365]
+    const int32_t monthIndex = (5 * dayOfYear + 2) / 153;                                     // [0, 11], March = 0
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = yearOfEra + era * 400 + (month <= 2);
+}
+
+int daysInMonth(int year, int month) {
+    static const uint8_t lengths[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2) {
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        return leap ? 29 : 28;
+    }
+    return lengths[(month - 1) % 12];
+}
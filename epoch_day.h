@@ -0,0 +1,33 @@
+#ifndef EPOCH_DAY_H
+#define EPOCH_DAY_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Calendar arithmetic on the epoch day number.
+ *
+ * An epoch day is the number of days since 1970-01-01 (proleptic Gregorian,
+ * negative before 1970). Conversions are closed-form, O(1), and do not touch
+ * the C library's time zone state.
+ */
+
+// Epoch day of a calendar date (month 1-12, day 1-31)
+int32_t epochDayFromCivil(int year, int month, int day);
+// Calendar date of an epoch day (month 1-12, day 1-31)
+void civilFromEpochDay(int32_t epochDay, int& year, int& month, int& day);
+// Number of days in a month (month 1-12)
+int daysInMonth(int year, int month);
+
+// Day of the week of an epoch day, 0 = Monday (1970-01-01 was a Thursday)
+inline int weekdayFromEpochDay(int32_t epochDay) {
+    int r = (int)((epochDay + 3) % 7);
+    return r < 0 ? r + 7 : r;
+}
+
+// Epoch day of a broken-down local time
+inline int32_t epochDayFromTm(const struct tm& t) {
+    return epochDayFromCivil(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+}
+
+#endif // EPOCH_DAY_H
@@ -8,6 +8,7 @@
 #include <ArduinoOTA.h>
 #include <ctime> // Ensure time functions and struct tm are available
 #include <time.h>
+#include <sys/time.h>
 #include "timeprefs.h"
 
 #include "config.h"
@@ -30,6 +31,14 @@ NetworkState testNetState;
 #include "webserver.h"
 #include "sprinkler_controller.h"
 #include "sprinkler_system_state.h"
+#include "boot_status.h"
+#include "control_task.h"
+#include "deep_sleep.h"
+#include "event_log.h"
+#include "latency_stats.h"
+#include "monotonic_clock.h"
+#include "power_policy.h"
+#include "wall_clock.h"
 SprinklerSystemState manualState;
 
 // Global variables
@@ -37,12 +46,20 @@ WebServer server(80);
 // No longer needed: using configTime() for NTP and timezone/DST
 SprinklerController sprinklerController(sprinklerPins, relayActiveLow, numSprinklers, statusLedPin);
 ScheduleManager* scheduleManager;
+ControlTask* controlTask;  // Zone control, started at the end of setup()
+LatencyProbe* handleClientProbe;  // Time in server.handleClient() (includes the route handlers)
+LatencyProbe* otaProbe;           // Time in ArduinoOTA.handle()
+
+// Boot: zones and scheduling start in setup(); WiFi, the web server and NTP attach from loop()
+// (Offline: a deep-sleep wake for a watering, or a time sync on such a wake that failed)
+enum class BootState : uint8_t { WifiConnecting, Online, AccessPoint, Offline };
+BootState bootState = BootState::WifiConnecting;
+uint64_t wifiStartedMs = 0;                                 // MonotonicClock time of WiFi.begin()
+const uint32_t WIFI_CONNECT_TIMEOUT_MS = 10000;             // Then fall back to AP mode
+const uint32_t CLOCK_SAVE_INTERVAL_MS = 60UL * 60 * 1000;   // Last-known time saved hourly
 
 // Timing variables
 unsigned long lastHeartbeat = 0;
-unsigned long lastScheduleCheck = 0;
-unsigned long lastBlink = 0;
-bool ledState = false;
 
 // Wrapper functions for WebServer handlers
 // REMOVED: handleRootWrapper is not needed, root route handled in setupWebServerRoutes
@@ -81,6 +98,7 @@ void handleManualControl7() { handleManualControl(server, *scheduleManager, manu
 // Update handlers
 void handleUpdateUploadWrapper() {
   HTTPUpload& upload = server.upload();
+  powerPolicy.noteActivity(MonotonicClock::nowMs()); // Full speed for the whole upload
   if (upload.status == UPLOAD_FILE_START) {
     // Serial.printf("Update: %s\n", upload.filename.c_str());
     // Serial.println("Updating firmware only (preserving EEPROM data)");
@@ -151,13 +169,20 @@ String format12HourTime(int hours, int minutes) {
 /**
  * @brief Arduino setup function.
  *
- * Initializes hardware, loads configuration, connects to WiFi, sets up web server and OTA, and prepares the system for operation.
+ * Initializes hardware, loads configuration and the last known time, starts zone control and
+ * starts connecting to WiFi. Nothing here waits on the network: bootStep() in loop() attaches
+ * the web server, OTA and NTP once WiFi is up, or starts AP mode.
  */
 void setup() {
   testNetState.ssid = testNetState.ssid; // Assign the global SSID to the encapsulated member
   testNetState.password = testNetState.password; // Assign the global password to the encapsulated member
 
   Serial.begin(115200);
+  deepSleep.begin(); // Timer wake from deep sleep, or power-on
+  eventLog.begin(); // Log messages reach Serial from the low-priority drain task
+  latencyStats.begin();
+  handleClientProbe = latencyStats.probe("loop: handleClient");
+  otaProbe = latencyStats.probe("loop: ArduinoOTA.handle");
   
   sprinklerController.begin();
   // Ensure all relays start OFF at boot
@@ -178,20 +203,18 @@ void setup() {
 
   scheduleManager = new ScheduleManager(numSprinklers, &sprinklerController);
   scheduleManager->loadPrograms();
+  controlTask = new ControlTask(*scheduleManager, manualState, sprinklerController);
   // Ensure all sprinkler relay pins are initialized as OUTPUT
   for (int i = 0; i < numSprinklers; i++) {
     // Sprinkler::init is now handled in ScheduleManager constructor
   }
-  // Force calculation of today's schedules after loading programs
-  time_t now;
-  struct tm timeinfo;
-  int today;
-  int wifiCounter = 0;
-  time(&now);
-  localtime_r(&now, &timeinfo);
-  today = timeinfo.tm_wday - 1; // Convert to 0=Monday
-  if (today < 0) today = 6;
-  scheduleManager->calculateZoneSchedules(today);
+  // Clock first: the stored timezone, and the RTC time (soft restart) or the
+  // last saved time (cold boot), so the schedule can run before WiFi and NTP
+  loadTimezonePreferences();
+  bootStatus.clockSource = restoreLastKnownTime();
+
+  // No schedule build here: the control task's first pass sets the schedule date
+  // from the clock restored above and builds today's schedule for it
   if (!scheduleManager->verifyPrograms()) {
     Serial.println("Invalid programs found, initializing...");
     scheduleManager->initializePrograms();
@@ -205,384 +228,324 @@ void setup() {
     scheduleManager->sprinklers[i].state = false;
   }
   
+  // Zones and scheduling come up now; WiFi, the web server and NTP attach from loop()
+  controlTask->begin();
+  Serial.println("Zone control task started");
+
+  if (deepSleep.isScheduledWake() && !deepSleep.timeSyncDue(WallClock::now())) {
+    // Woken for a watering: the RTC kept the clock, so no WiFi, NTP or web server this time
+    bootState = BootState::Offline;
+    LOG_INFO("Deep-sleep wake for program %c", programLetter(deepSleep.record().program >= 0 ? deepSleep.record().program : 0));
+    return;
+  }
+
   // Disconnect any current WiFi connection to force new settings
   WiFi.disconnect(true);
-  delay(100);
   if (!WiFi.config(local_IP, gateway, subnet, primaryDNS, secondaryDNS)) {
     Serial.println("STA Failed to configure");
   }
-  
-  // Flash LED to indicate WiFi connection attempt
-  for (int i = 0; i < 3; i++) {
-    sprinklerController.setStatusLed(true);
-    delay(200);
-    sprinklerController.setStatusLed(false);
-    delay(200);
-  }
-  
+  watchTimeSync();
   WiFi.begin(testNetState.ssid.c_str(), testNetState.password.c_str());
-  Serial.print("Connecting to WiFi");
-  
-  // Blink LED while connecting to WiFi
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
-    sprinklerController.setStatusLed(wifiCounter % 2 == 0);
-    wifiCounter++;
-    if (wifiCounter > 20) { // 10 seconds timeout
-      // WiFi failed, start AP mode
-      WiFi.mode(WIFI_AP);
-      WiFi.softAP("Sprinkler_Setup", "configure123");
-      IPAddress apIP(192,168,4,1);
-      IPAddress netMsk(255,255,255,0);
-      WiFi.softAPConfig(apIP, apIP, netMsk);
-
-      server.on("/", HTTP_GET, []() {
-        server.send(200, "text/html", "<h1>ESP32 Sprinkler AP Mode</h1><p>Connected!</p><p><a href='/wifi'>Configure WiFi</a></p>");
-      });
-      // WiFi configuration page (GET)
-      server.on("/wifi", HTTP_GET, []() {
-        int n = WiFi.scanNetworks();
-        String ssidOptions = "";
-        for (int i = 0; i < n; i++) {
-          String s = WiFi.SSID(i);
-          if (s.length() == 0) continue;
-          ssidOptions += "<option value='" + s + "'";
-          if (s == testNetState.ssid) ssidOptions += " selected";
-          ssidOptions += ">" + s + "</option>";
-        }
-        // Determine if static IP was previously set
-        Preferences prefs;
-        prefs.begin("wifi", true);
-        bool useStatic = prefs.getBool("use_static_ip", false);
-        prefs.end();
-        String html = "<html><head><title>WiFi Setup</title>\n";
-        html += "<script>\nfunction toggleStaticIP() {\n  var checked = document.getElementById('use_static').checked;\n  var fields = document.getElementsByClassName('static-field');\n  for (var i = 0; i < fields.length; i++) {\n    fields[i].style.display = checked ? 'block' : 'none';\n  }\n}\nwindow.onload = toggleStaticIP;\n<\/script></head><body>";
-        html += "<h1>WiFi Configuration</h1>";
-        html += "<form method='POST' action='/wifi'>";
-        html += "SSID: <select name='ssid'>" + ssidOptions + "</select><br>";
-        html += "Password: <input name='password' type='text' value='" + testNetState.password + "'><br>";
-        html += "<input type='checkbox' id='use_static' name='use_static' value='1' onchange='toggleStaticIP()'";
-        if (useStatic) html += " checked";
-        html += "> Set Static IP<br>";
-        html += String("<div class='static-field' style='display:") + (useStatic ? "block" : "none") + ";'>";
-        html += "Static IP: <input name='ip' value='" + local_IP.toString() + "'><br>";
-        html += "Gateway: <input name='gw' value='" + gateway.toString() + "'><br>";
-        html += "Subnet: <input name='sn' value='" + subnet.toString() + "'><br>";
-        html += "DNS1: <input name='dns1' value='" + primaryDNS.toString() + "'><br>";
-        html += "DNS2: <input name='dns2' value='" + secondaryDNS.toString() + "'><br>";
-        html += "</div>";
-        html += "<input type='submit' value='Save & Connect'>";
-        html += "</form></body></html>";
-        server.send(200, "text/html", html);
-      });
-      // WiFi configuration (POST)
-      server.on("/wifi", HTTP_POST, []() {
-        String ssid = server.arg("ssid");
-        String password = server.arg("password");
-        bool useStatic = server.hasArg("use_static");
-        String ip = server.arg("ip");
-        String gw = server.arg("gw");
-        String sn = server.arg("sn");
-        String dns1 = server.arg("dns1");
-        String dns2 = server.arg("dns2");
-        // Store to Preferences
-        Preferences prefs;
-        prefs.begin("wifi", false);
-        prefs.putString("ssid", ssid);
-        prefs.putString("pass", password);
-        prefs.putBool("use_static_ip", useStatic);
-        prefs.putString("ip", ip);
-        prefs.putString("gw", gw);
-        prefs.putString("sn", sn);
-        prefs.putString("dns1", dns1);
-        prefs.putString("dns2", dns2);
-        prefs.end();
-        server.send(200, "text/html", "<h1>Saved. Rebooting...</h1>");
-        delay(1200);
-        ESP.restart();
-      });
-      server.begin();
-      Serial.println("AP mode started. Connect to Sprinkler_Setup, password: configure123, then browse to http://192.168.4.1");
-      return;
+  wifiStartedMs = MonotonicClock::nowMs();
+  Serial.println("Connecting to WiFi");
+}
+
+/**
+ * @brief WiFi failed: serve the WiFi setup pages from our own access point.
+ */
+void startAccessPoint() {
+  bootState = BootState::AccessPoint;
+  bootStatus.accessPointMode = true;
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP("Sprinkler_Setup", "configure123");
+  IPAddress apIP(192,168,4,1);
+  IPAddress netMsk(255,255,255,0);
+  WiFi.softAPConfig(apIP, apIP, netMsk);
+
+  server.on("/", HTTP_GET, []() {
+    server.send(200, "text/html", "<h1>ESP32 Sprinkler AP Mode</h1><p>Connected!</p><p><a href='/wifi'>Configure WiFi</a></p>");
+  });
+  // WiFi configuration page (GET)
+  server.on("/wifi", HTTP_GET, []() {
+    int n = WiFi.scanNetworks();
+    String ssidOptions = "";
+    for (int i = 0; i < n; i++) {
+      String s = WiFi.SSID(i);
+      if (s.length() == 0) continue;
+      ssidOptions += "<option value='" + s + "'";
+      if (s == testNetState.ssid) ssidOptions += " selected";
+      ssidOptions += ">" + s + "</option>";
     }
-  }
+    // Determine if static IP was previously set
+    Preferences prefs;
+    prefs.begin("wifi", true);
+    bool useStatic = prefs.getBool("use_static_ip", false);
+    prefs.end();
+    String html = "<html><head><title>WiFi Setup</title>\n";
+    html += "<script>\nfunction toggleStaticIP() {\n  var checked = document.getElementById('use_static').checked;\n  var fields = document.getElementsByClassName('static-field');\n  for (var i = 0; i < fields.length; i++) {\n    fields[i].style.display = checked ? 'block' : 'none';\n  }\n}\nwindow.onload = toggleStaticIP;\n<\/script></head><body>";
+    html += "<h1>WiFi Configuration</h1>";
+    html += "<form method='POST' action='/wifi'>";
+    html += "SSID: <select name='ssid'>" + ssidOptions + "</select><br>";
+    html += "Password: <input name='password' type='text' value='" + testNetState.password + "'><br>";
+    html += "<input type='checkbox' id='use_static' name='use_static' value='1' onchange='toggleStaticIP()'";
+    if (useStatic) html += " checked";
+    html += "> Set Static IP<br>";
+    html += String("<div class='static-field' style='display:") + (useStatic ? "block" : "none") + ";'>";
+    html += "Static IP: <input name='ip' value='" + local_IP.toString() + "'><br>";
+    html += "Gateway: <input name='gw' value='" + gateway.toString() + "'><br>";
+    html += "Subnet: <input name='sn' value='" + subnet.toString() + "'><br>";
+    html += "DNS1: <input name='dns1' value='" + primaryDNS.toString() + "'><br>";
+    html += "DNS2: <input name='dns2' value='" + secondaryDNS.toString() + "'><br>";
+    html += "</div>";
+    html += "<input type='submit' value='Save & Connect'>";
+    html += "</form></body></html>";
+    server.send(200, "text/html", html);
+  });
+  // WiFi configuration (POST)
+  server.on("/wifi", HTTP_POST, []() {
+    String ssid = server.arg("ssid");
+    String password = server.arg("password");
+    bool useStatic = server.hasArg("use_static");
+    String ip = server.arg("ip");
+    String gw = server.arg("gw");
+    String sn = server.arg("sn");
+    String dns1 = server.arg("dns1");
+    String dns2 = server.arg("dns2");
+    // Store to Preferences
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.putString("ssid", ssid);
+    prefs.putString("pass", password);
+    prefs.putBool("use_static_ip", useStatic);
+    prefs.putString("ip", ip);
+    prefs.putString("gw", gw);
+    prefs.putString("sn", sn);
+    prefs.putString("dns1", dns1);
+    prefs.putString("dns2", dns2);
+    prefs.end();
+    server.send(200, "text/html", "<h1>Saved. Rebooting...</h1>");
+    delay(1200);
+    ESP.restart();
+  });
+  server.begin();
+  LOG_WARN("No WiFi after %lu ms: AP Sprinkler_Setup (password configure123) at http://192.168.4.1",
+           (unsigned long)WIFI_CONNECT_TIMEOUT_MS);
+}
 
-  // Solid LED for 1 second to indicate successful connection
-  sprinklerController.setStatusLed(true);
-  delay(1000);
+/**
+ * @brief WiFi connected: start NTP, the web server routes and OTA.
+ */
+void attachNetwork() {
+  bootState = BootState::Online;
+  bootStatus.wifiConnectedMs = (uint32_t)MonotonicClock::nowMs();
   sprinklerController.setStatusLed(false);
+  IPAddress ip = WiFi.localIP();
+  LOG_INFO("WiFi connected %lu ms after boot, IP %d.%d.%d.%d",
+           (unsigned long)bootStatus.wifiConnectedMs, ip[0], ip[1], ip[2], ip[3]);
 
-  Serial.println("\nWiFi connected!");
-  Serial.print("IP Address: ");
-  Serial.println(WiFi.localIP());
-
-  // Initialize time using configTime()
-  configTzTime("EST5EDT,M3.2.0/2,M11.1.0/2", "pool.ntp.org", "time.nist.gov");
-  while (!getLocalTime(&timeinfo)) {
-    Serial.println("Waiting for NTP...");
-    delay(1000);
-  }
-  Serial.printf("Local time: %02d:%02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
-
+  startTimeSync();
   // Register all web server routes (including root)
   setupWebServerRoutes(server, *scheduleManager, manualState);
-
   setupOTA();
+  server.begin();
+  LOG_INFO("Web server and OTA started");
+}
 
-  // Visual indicator that OTA setup is complete
-  Serial.println("OTA setup complete");
-  for (int i = 0; i < 3; i++) {
-    sprinklerController.setStatusLed(true);
-    delay(100);
-    sprinklerController.setStatusLed(false);
-    delay(100);
+/**
+ * @brief Advances boot from loop() without blocking.
+ *
+ * Waits for WiFi (blinking the LED) and falls back to AP mode after
+ * WIFI_CONNECT_TIMEOUT_MS. Applies NTP syncs whenever they arrive and saves
+ * the clock every CLOCK_SAVE_INTERVAL_MS for the next cold boot.
+ */
+void bootStep() {
+  static uint64_t lastBlink = 0;
+  static uint64_t lastClockSave = 0;
+  static bool blinkOn = false;
+  uint64_t now = MonotonicClock::nowMs();
+
+  if (takeTimeSync()) {
+    if (bootStatus.timeSyncedMs == 0) bootStatus.timeSyncedMs = (uint32_t)now;
+    bootStatus.clockSource = ClockSource::Ntp;
+    deepSleep.noteTimeSync(WallClock::now());
+    saveLastKnownTime();
+    lastClockSave = now;
+    {
+      ControlLock lock;
+      scheduleManager->requestScheduleCheck(); // The clock may have jumped
+    }
+    controlTask->wake();
+    LOG_INFO("Clock set by NTP");
+  }
+  if (now - lastClockSave >= CLOCK_SAVE_INTERVAL_MS) {
+    saveLastKnownTime();
+    lastClockSave = now;
   }
 
-  server.begin();
-  Serial.println("Web server started");
-  Serial.print("Access the controller at http://");
-  Serial.println(WiFi.localIP());
+  if (bootState != BootState::WifiConnecting) return;
+  if (WiFi.status() == WL_CONNECTED) {
+    attachNetwork();
+  } else if (now - wifiStartedMs > WIFI_CONNECT_TIMEOUT_MS) {
+    if (deepSleep.isScheduledWake()) {
+      // Time sync on a deep-sleep wake: no setup AP on a remote site, try again next wake
+      bootState = BootState::Offline;
+      WiFi.mode(WIFI_OFF);
+      LOG_WARN("No WiFi for the time sync");
+    } else {
+      startAccessPoint();
+    }
+  } else if (now - lastBlink >= 500 && controlSnapshot().zoneOnMask == 0) {
+    // Blink while connecting (the control task blinks the LED while zones run)
+    blinkOn = !blinkOn;
+    sprinklerController.setStatusLed(blinkOn);
+    lastBlink = now;
+  }
 }
 
 /**
- * @brief Arduino main loop.
+ * @brief Reads console commands from Serial.
  *
- * Handles periodic tasks, processes web server requests, and manages sprinkler state (manual, scheduled, Quick Run).
+ * "latency" prints the handler and control-phase latency histograms,
+ * "latency reset" clears them.
  */
-void loop() {
-  static unsigned long lastHeartbeat = 0;
-  static unsigned long lastScheduleCheck = 0;
-  static unsigned long lastDiagnostic = 0;
-  
-  // Process web requests and OTA
-  server.handleClient();
-  ArduinoOTA.handle();
-
-  // --- CENTRALIZED RELAY CONTROL ---
-  // 1. Run Program Now (program-based) logic
-  if (scheduleManager->runProgramNowActive) {
-    for (int i = 0; i < scheduleManager->count; ++i) {
-      bool shouldBeOn = (i == scheduleManager->runProgramNowCurrentZone);
-      scheduleManager->sprinklers[i].setState(shouldBeOn);
+void handleSerialCommand() {
+  static String line;
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (line.length() < 32) line += c;
+      continue;
     }
-    scheduleManager->updateRunProgramNow();
-    // While Run Program Now is active, skip all other schedule/manual logic
-    return;
+    line.trim();
+    if (line == "latency") {
+      Serial.print(latencyStats.toText());
+    } else if (line == "latency reset") {
+      latencyStats.reset();
+      Serial.println("Latency histograms cleared");
+    } else if (line.length() > 0) {
+      Serial.println("Commands: latency, latency reset");
+    }
+    line = "";
   }
-  // 2. Quick Run (standalone) logic
-  if (scheduleManager->isQuickRunActive()) {
-    for (int i = 0; i < scheduleManager->count; ++i) {
-      bool shouldBeOn = (i == scheduleManager->quickRunCurrentZone);
-      scheduleManager->sprinklers[i].setState(shouldBeOn);
+}
+
+/**
+ * @brief Picks the power state from the control snapshot and the next schedule event.
+ *
+ * Sets the CPU clock and WiFi power save (PowerPolicy::apply()), and stretches the
+ * control pass period to match; loop() sleeps powerPolicy.loopDelayMs() after each pass.
+ */
+void powerStep() {
+  ControlSnapshot snapshot = controlSnapshot();
+  PowerInputs inputs;
+  inputs.nowMs = MonotonicClock::nowMs();
+  inputs.zonesRunning = snapshot.zoneOnMask != 0 || snapshot.quickRunZone >= 0 ||
+                        snapshot.runProgramNowIndex >= 0 || snapshot.manualMode;
+  inputs.networkBusy = bootState == BootState::WifiConnecting || bootState == BootState::AccessPoint;
+  inputs.msToNextEvent = -1;
+  time_t now = WallClock::now();
+  if (isClockValid(now)) {
+    ControlLock lock;
+    if (!scheduleManager->scheduleCheckPending) {
+      time_t next = scheduleManager->nextTransitionTime;
+      inputs.msToNextEvent = next > now ? (int64_t)(next - now) * 1000 : 0;
+    } else {
+      inputs.msToNextEvent = 0; // A schedule pass is about to run
     }
-    scheduleManager->updateQuickRun();
-    return;
   }
-  // 3. Manual Mode logic
-  if (manualState.isManualMode()) {
-    // In manual mode, relay state is managed by manual control endpoints.
-    // No automatic control here to ensure user has full control.
-    return;
+  PowerState before = powerPolicy.state();
+  PowerState state = powerPolicy.update(inputs);
+  if (state != before) {
+    controlTask->setPeriodMs(powerPolicy.controlPeriodMs());
+    LOG_INFO("Power state %s", PowerPolicy::stateName(state));
+  }
+}
+
+/**
+ * @brief Deep-sleeps until the next program start when deep sleep is enabled and nothing is due.
+ *
+ * Also measures wake-to-relay time after a deep-sleep wake (within one loop() pass).
+ * Does not return when it sleeps: the next boot is the wake.
+ */
+void deepSleepStep() {
+  ControlSnapshot snapshot = controlSnapshot();
+  uint64_t nowMs = MonotonicClock::nowMs();
+  deepSleep.noteZones(snapshot.zoneOnMask, nowMs, WallClock::nowMs());
+  if (!deepSleep.isEnabled()) return;
+
+  time_t now = WallClock::now();
+  bool busy = snapshot.zoneOnMask != 0 || snapshot.quickRunZone >= 0 ||
+              snapshot.runProgramNowIndex >= 0 || snapshot.manualMode ||
+              bootState == BootState::WifiConnecting;
+  // A time sync on this wake gets TIME_SYNC_TIMEOUT_MS once WiFi is up
+  if (bootState == BootState::Online && deepSleep.timeSyncDue(now) && nowMs < DeepSleep::TIME_SYNC_TIMEOUT_MS) busy = true;
+  uint64_t lastActivity = powerPolicy.lastActivityMs();
+  uint64_t quietMs = lastActivity == 0 ? UINT64_MAX : nowMs - lastActivity;
+  DeepSleepPlan plan;
+  {
+    ControlLock lock;
+    plan = deepSleep.plan(*scheduleManager, now, nowMs, quietMs, busy);
   }
+  if (!plan.sleep) return;
+
+  LOG_INFO("Deep sleep for %ld s (program %c at %ld)", (long)(plan.wakeAt - now),
+           programLetter(plan.program >= 0 ? plan.program : 0), (long)plan.eventAt);
+  controlTask->end(); // No pass may switch a relay back on
+  saveLastKnownTime(); // In case power is lost while asleep
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  eventLog.end(); // Single drainer: the drain task finishes its pass, then this flushes the rest
+  eventLog.drain(EventLog::CAPACITY);
+  Serial.flush();
+  deepSleep.sleep(plan, now, sprinklerController);
+}
+
+/**
+ * @brief Arduino main loop.
+ *
+ * Processes web server and OTA requests and does background work. Sprinkler state
+ * (manual, scheduled, Quick Run) is managed by the zone control task (ControlTask).
+ */
+void loop() {
+  static uint64_t lastHeartbeat = 0;
   
-  if (millis() - lastDiagnostic > 1000) {  // Every 1 second
-    lastDiagnostic = millis();
-    
-    // Get current time
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-    
-    // Convert to our day indexing (0=Monday to 6=Sunday)
-    int systemDay = timeinfo.tm_wday; // 0=Sunday in system
-    int ourDay = (systemDay == 0) ? 6 : systemDay - 1; // Convert to our format
-    
-    Serial.printf("\n--------- SCHEDULE DIAGNOSTICS ---------\n");
-    Serial.printf("Current date/time: %04d-%02d-%02d %02d:%02d:%02d\n", 
-                  timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                  timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
-    Serial.printf("Day of Week: %d (System), %d (Our format, 0=Mon)\n", systemDay, ourDay);
-    Serial.printf("Day Name: %s\n", WeekdayUtils::toString((Weekday)ourDay).c_str());
-    
-    // Calculate minutes since midnight
-    int currentMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
-    Serial.printf("Minutes since midnight: %d\n", currentMinutes);
-    
-    // Check each sprinkler's schedule for today
-    Serial.println("Today's schedules:");
-    bool anyPeriodsFound = false;
-    
-    for (int i = 0; i < numSprinklers; i++) {
-      // Check each calculated schedule for this sprinkler
-      for (int p = 0; p < 3; p++) {
-        
-        bool hasSchedules = false;
-        // Serial.printf("\nSprinkler %d:\n", i + 1);
-        
-        for (int p = 0; p < 3; p++) {
-          CalculatedSchedule &schedule = scheduleManager->sprinklers[i].calculatedSchedules[p];
-          if (schedule.startTime.length() == 5 && schedule.endTime.length() == 5) {
-            hasSchedules = true;
-            anyPeriodsFound = true;
-            Serial.printf("  Program %d: %s - %s\n",
-                          p + 1, schedule.startTime.c_str(), schedule.endTime.c_str());
-          }
-        }
-        
-        if (!hasSchedules) {
-          // Serial.println("  No active schedules");
-        }
-      }
-      
-      if (!anyPeriodsFound) {
-        // Serial.println("No active schedules found for any sprinkler.");
-      }
+  // Process web requests and OTA (zone control runs in controlTask)
+  {
+    ScopedLatency timer(handleClientProbe);
+    server.handleClient();
+  }
+  {
+    ScopedLatency timer(otaProbe);
+    ArduinoOTA.handle();
+  }
+  handleSerialCommand();
+  bootStep();
+  powerStep();
+  deepSleepStep();
+
+  // Idle time: build tomorrow's schedule so midnight only swaps it in, and the new
+  // week's occupancy index after a Monday rollover
+  {
+    ControlLock lock;
+    if (scheduleManager->prepareNextDaySchedule()) {
+      LOG_INFO("Prepared next day's schedule");
+    }
+    if (scheduleManager->refreshOccupancyIndex()) {
+      LOG_INFO("Rebuilt the occupancy index for the new week");
     }
   }
   
   // Simple heartbeat indicator every 10 seconds
-  if (millis() - lastHeartbeat > 10000) {
-    Serial.println("Controller running, waiting for connections...");
-    Serial.print("IP Address: ");
-    Serial.println(WiFi.localIP());
-    Serial.print("Current Day: ");
-    Serial.println(WeekdayUtils::toString((Weekday)WeekdayUtils::todayAsIndex()));
-    time_t now;
+  if (MonotonicClock::nowMs() - lastHeartbeat > 10000) {
     struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-    Serial.print("Current Time: ");
-    Serial.printf("%02d:%02d\n", timeinfo.tm_hour, timeinfo.tm_min);
-    Serial.print("Manual Mode: ");
-    Serial.println(manualState.isManualMode() ? "ON" : "OFF");
-    lastHeartbeat = millis();
-  }
-  
-  // Check schedules every minute
-  if (!manualState.isManualMode() && millis() - lastScheduleCheck >= 1000) {
-    lastScheduleCheck = millis();
-    
-    // Get current time from system clock
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
-    
-    int currentHour = timeinfo.tm_hour;
-    int currentMinute = timeinfo.tm_min;
-    int currentTotal = currentHour * 60 + currentMinute;
-    
-    // Get current weekday (0 = Monday)
-    int today = (timeinfo.tm_wday + 6) % 7;
-    
-    Serial.printf("\nChecking schedules at %02d:%02d on %s (Day %d)\n", 
-                  currentHour, currentMinute, 
-                  WeekdayUtils::toString((Weekday)today).c_str(), today);
-    
-    static int lastDay = -1;
-    if (today != lastDay) {
-      // Day has changed, recalculate schedules
-      Serial.println("New day detected, recalculating schedules");
-      scheduleManager->calculateZoneSchedules(today);
-      lastDay = today;
-    }
-    
-    // Check if any sprinklers need to be toggled based on schedule
-    for (int i = 0; i < scheduleManager->count; i++) {
-      // Skip if sprinkler is disabled
-      if (scheduleManager->sprinklers[i].disabled) {
-        if (scheduleManager->sprinklers[i].state) {
-          // Turn off if it was on
-          scheduleManager->sprinklers[i].setState(false);
-          // Serial.printf("Sprinkler %d turned OFF (disabled)\n", i + 1);
-        }
-        continue;
-      }
-
-      bool shouldBeOn = false;
-      
-      // Check each calculated schedule for this sprinkler
-      for (int p = 0; p < 3; p++) {
-        CalculatedSchedule &schedule = scheduleManager->sprinklers[i].calculatedSchedules[p];
-        
-        // Skip if no schedule
-        if (schedule.startTime.length() != 5 || schedule.endTime.length() != 5) continue;
-        
-        int startHour = schedule.startTime.substring(0, 2).toInt();
-        int startMin  = schedule.startTime.substring(3, 5).toInt();
-        int endHour   = schedule.endTime.substring(0, 2).toInt();
-        int endMin    = schedule.endTime.substring(3, 5).toInt();
-        int startTotal = startHour * 60 + startMin;
-        int endTotal = endHour * 60 + endMin;
-        
-        Serial.printf("  Checking Program %d: %02d:%02d (%d min) - %02d:%02d (%d min)\n", 
-                      schedule.programIndex + 1, startHour, startMin, startTotal, endHour, endMin, endTotal);
-        
-        bool periodShouldBeOn = false;
-        if (startTotal < endTotal) {
-          periodShouldBeOn = (currentTotal >= startTotal && currentTotal < endTotal);
-          Serial.printf("  Normal period (within day), Current: %d, Should be on: %s\n", 
-                        currentTotal, periodShouldBeOn ? "YES" : "no");
-        } else if (startTotal > endTotal) {
-          periodShouldBeOn = (currentTotal >= startTotal || currentTotal < endTotal);
-          Serial.printf("  Overnight period (spans midnight), Current: %d, Should be on: %s\n", 
-                        currentTotal, periodShouldBeOn ? "YES" : "no");
-        }
-        
-        if (periodShouldBeOn) {
-          shouldBeOn = true;
-          Serial.printf("  Program %d is ACTIVE - sprinkler should be ON\n", schedule.programIndex + 1);
-          break;
-        }
-      }
-      
-      // Update relay state if necessary using Sprinkler::setState()
-      if (scheduleManager->sprinklers[i].state != shouldBeOn) {
-        Serial.printf("  Changing state: Setting Sprinkler %d to %s\n", 
-                      i + 1, shouldBeOn ? "ON" : "OFF");
-        scheduleManager->sprinklers[i].setState(shouldBeOn);
-        Serial.printf("Sprinkler %d turned %s\n", i + 1, shouldBeOn ? "ON" : "OFF");
-      }
-    }
-    
-    // Blink the LED if any sprinkler is active in scheduled mode
-    bool anyActive = false;
-    for (int i = 0; i < scheduleManager->count; i++) {
-      if (scheduleManager->sprinklers[i].state) {
-        anyActive = true;
-        break;
-      }
-    }
-    
-    if (anyActive) {
-      if (millis() - lastBlink >= 500) {
-        ledState = !ledState;
-        sprinklerController.setStatusLed(ledState);
-        lastBlink = millis();
-      }
-    } else {
-      sprinklerController.setStatusLed(false);
-    }
-  } else if (!manualState.isManualMode()) {
-    // LED blinking when not checking schedules
-    bool anyActive = false;
-    for (int i = 0; i < scheduleManager->count; i++) {
-      if (scheduleManager->sprinklers[i].state) {
-        anyActive = true;
-        break;
-      }
-    }
-    
-    if (anyActive) {
-      if (millis() - lastBlink >= 500) {
-        ledState = !ledState;
-        sprinklerController.setStatusLed(ledState);
-        lastBlink = millis();
-      }
-    }
+    WallClock::localNow(timeinfo);
+    IPAddress ip = WiFi.localIP();
+    LOG_DEBUG("Controller running at %d.%d.%d.%d, manual mode %s",
+              ip[0], ip[1], ip[2], ip[3], manualState.isManualMode() ? "ON" : "OFF");
+    LOG_DEBUG("Current time: %s %02d:%02d",
+              WeekdayUtils::name((Weekday)WeekdayUtils::todayAsIndex()), timeinfo.tm_hour, timeinfo.tm_min);
+    lastHeartbeat = MonotonicClock::nowMs();
   }
   
-  delay(5); // Much shorter delay for responsiveness
+  delay(powerPolicy.loopDelayMs()); // 5 ms while active, longer between watering events
 }
\ No newline at end of file
@@ -0,0 +1,185 @@
+/**
+ * @file event_log.cpp
+ * @brief Binary log ring buffer, deferred formatting and the Serial drain task.
+ */
+
+#include "event_log.h"
+#include <stdio.h>
+#include <string.h>
+
+EventLog eventLog;
+thread_local int EventLog::_muted = 0;
+
+void EventLog::lock() const {
+    portENTER_CRITICAL(&_mux);
+}
+
+void EventLog::unlock() const {
+    portEXIT_CRITICAL(&_mux);
+}
+
+void EventLog::append(uint8_t level, const char* format, const uintptr_t* args, uint8_t argCount) {
+    uint32_t timeMs = millis();
+    lock();
+    LogEntry& entry = _entries[_next % CAPACITY];
+    entry.sequence = _next;
+    entry.timeMs = timeMs;
+    entry.format = format;
+    entry.level = level;
+    entry.argCount = argCount;
+    memcpy(entry.args, args, argCount * sizeof(uintptr_t));
+    _next++;
+    unlock();
+}
+
+uint32_t EventLog::drain(uint32_t maxEntries) {
+    uint32_t written = 0;
+    while (written < maxEntries) {
+        LogEntry entry;
+        lock();
+        if (_next - _drainNext > CAPACITY) {
+            // Overwritten before we got to them
+            _dropped += _next - _drainNext - CAPACITY;
+            _drainNext = _next - CAPACITY;
+        }
+        bool pending = _drainNext != _next;
+        if (pending) {
+            entry = _entries[_drainNext % CAPACITY];
+            _drainNext++;
+        }
+        unlock();
+        if (!pending) break;
+        // Formatting and Serial output happen outside the critical section
+        Serial.println(format(entry));
+        written++;
+    }
+    return written;
+}
+
+String EventLog::dump() const {
+    const uint32_t CHUNK = 16; // Entries copied per critical section
+    LogEntry chunk[CHUNK];
+    String out;
+    lock();
+    uint32_t next = _next > CAPACITY ? _next - CAPACITY : 0;
+    uint32_t end = _next;
+    unlock();
+    out.reserve((end - next) * 64);
+    while (next != end) {
+        uint32_t count = 0;
+        lock();
+        if (_next - next > CAPACITY) next = _next - CAPACITY; // Overwritten while we formatted
+        while (count < CHUNK && next != end && next != _next) {
+            chunk[count++] = _entries[next % CAPACITY];
+            next++;
+        }
+        unlock();
+        if (count == 0) break;
+        for (uint32_t i = 0; i < count; i++) {
+            out += format(chunk[i]);
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+uint32_t EventLog::recorded() const {
+    lock();
+    uint32_t count = _next;
+    unlock();
+    return count;
+}
+
+uint32_t EventLog::dropped() const {
+    lock();
+    uint32_t count = _dropped;
+    unlock();
+    return count;
+}
+
+const char* EventLog::levelName(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR: return "E";
+        case LOG_LEVEL_WARN:  return "W";
+        case LOG_LEVEL_INFO:  return "I";
+        default:              return "D";
+    }
+}
+
+String EventLog::format(const LogEntry& entry) {
+    char line[160];
+    size_t used = snprintf(line, sizeof(line), "%6lu.%03lu %s ",
+                           (unsigned long)(entry.timeMs / 1000), (unsigned long)(entry.timeMs % 1000),
+                           levelName(entry.level));
+    const char* p = entry.format;
+    uint8_t arg = 0;
+    while (*p && used < sizeof(line) - 1) {
+        if (*p != '%') {
+            line[used++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            line[used++] = '%';
+            p += 2;
+            continue;
+        }
+        // Copy flags, width and precision; drop length modifiers (arguments are int-sized)
+        char spec[16];
+        size_t len = 0;
+        spec[len++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && len < sizeof(spec) - 2) spec[len++] = *p++;
+        while (*p && strchr("hlzjt", *p)) p++;
+        char conversion = *p;
+        if (!conversion) break;
+        p++;
+        spec[len++] = conversion;
+        spec[len] = '\0';
+        uintptr_t value = arg < entry.argCount ? entry.args[arg] : 0;
+        arg++;
+        int n;
+        switch (conversion) {
+            case 'd': case 'i': case 'c':
+                n = snprintf(line + used, sizeof(line) - used, spec, (int)(intptr_t)value);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                n = snprintf(line + used, sizeof(line) - used, spec, (unsigned int)value);
+                break;
+            case 's':
+                n = snprintf(line + used, sizeof(line) - used, spec, value ? (const char*)value : "(null)");
+                break;
+            default:
+                n = snprintf(line + used, sizeof(line) - used, "%%%c", conversion);
+                break;
+        }
+        if (n > 0) used += (size_t)n;
+        if (used > sizeof(line) - 1) used = sizeof(line) - 1;
+    }
+    line[used] = '\0';
+    return String(line);
+}
+
+void EventLog::taskMain(void* arg) {
+    EventLog* log = static_cast<EventLog*>(arg);
+    while (!log->_stopRequested.load()) {
+        // Work through a backlog one tick at a time, otherwise sleep a period
+        bool backlog = log->drain() == DRAIN_BATCH;
+        vTaskDelay(backlog ? 1 : pdMS_TO_TICKS(DRAIN_PERIOD_MS));
+    }
+    // Never deleted from outside, so it cannot stop halfway through a Serial write
+    log->_taskRunning.store(false);
+    vTaskDelete(nullptr);
+}
+
+void EventLog::begin() {
+    if (_handle) return;
+    _stopRequested.store(false);
+    _taskRunning.store(true);
+    xTaskCreate(taskMain, "log_drain", STACK_SIZE, this, PRIORITY, &_handle);
+}
+
+void EventLog::end() {
+    if (!_handle) return;
+    _stopRequested.store(true);
+    while (_taskRunning.load()) vTaskDelay(1);
+    _handle = nullptr;
+}
@@ -0,0 +1,133 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <atomic>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN  1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_DEBUG 3
+
+// Calls above this level are compiled out entirely (build flag, e.g. -DLOG_COMPILE_LEVEL=LOG_LEVEL_INFO)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// One log call, stored unformatted
+struct LogEntry {
+    static const int MAX_ARGS = 8;
+
+    uint32_t sequence;       // Entries recorded before this one
+    uint32_t timeMs;         // millis() when recorded
+    const char* format;      // printf-style string literal
+    uint8_t level;
+    uint8_t argCount;
+    uintptr_t args[MAX_ARGS]; // Integers, chars and string literals
+};
+
+/**
+ * @brief Leveled log kept as a ring of binary entries and formatted later.
+ *
+ * Recording a message copies the format pointer and its arguments into the
+ * ring and returns, so the control task never waits on Serial. A low-priority
+ * drain task formats entries and writes them to Serial; the last CAPACITY
+ * entries can also be dumped as text (GET /log). When the drain falls behind
+ * the oldest entries are overwritten and counted in dropped().
+ *
+ * Formats and string arguments must be literals (or otherwise outlive the
+ * entry): only the pointer is kept. Arguments are int-sized integers, chars,
+ * bools or const char*; a String argument does not compile.
+ * Only %d %i %u %x %X %o %c %s and %% (with flags, width and precision) are
+ * understood; length modifiers are ignored.
+ */
+class EventLog {
+public:
+    static const uint32_t CAPACITY = 128;
+    static const uint32_t DRAIN_PERIOD_MS = 50;
+    static const uint32_t DRAIN_BATCH = 16;    // Entries written to Serial per drain pass
+    static const uint32_t STACK_SIZE = 4096;   // Bytes (FreeRTOS drain task stack)
+    static const int PRIORITY = 1;             // Same as loop(), below the control task
+
+    template <typename... Args>
+    void record(uint8_t level, const char* format, Args... args) {
+        static_assert(sizeof...(Args) <= LogEntry::MAX_ARGS, "Too many log arguments");
+        if (level > _level || _muted) return;
+        const uintptr_t values[sizeof...(Args) + 1] = {toArg(args)..., 0};
+        append(level, format, values, sizeof...(Args));
+    }
+
+    void setLevel(uint8_t level) { _level = level > LOG_LEVEL_DEBUG ? LOG_LEVEL_DEBUG : level; }
+    uint8_t level() const { return _level; }
+
+    void begin();                // Start the drain task
+    void end();                  // Stop the drain task after its current pass (then drain() alone writes)
+    uint32_t drain(uint32_t maxEntries = DRAIN_BATCH); // Write pending entries to Serial; returns how many
+    String dump() const;         // Buffered entries, oldest first, one line each
+    uint32_t recorded() const;   // Entries recorded since boot
+    uint32_t dropped() const;    // Entries overwritten before the drain wrote them
+
+    static String format(const LogEntry& entry);
+    static const char* levelName(uint8_t level);
+
+    // Drops the calling thread's records while in scope (simulations)
+    class Mute {
+    public:
+        Mute() { _muted++; }
+        ~Mute() { _muted--; }
+        Mute(const Mute&) = delete;
+        Mute& operator=(const Mute&) = delete;
+    };
+
+private:
+    static uintptr_t toArg(int value) { return (uintptr_t)(intptr_t)value; }
+    static uintptr_t toArg(unsigned int value) { return (uintptr_t)value; }
+    static uintptr_t toArg(long value) { return (uintptr_t)(intptr_t)value; }
+    static uintptr_t toArg(unsigned long value) { return (uintptr_t)value; }
+    static uintptr_t toArg(const char* value) { return (uintptr_t)value; }
+
+    void append(uint8_t level, const char* format, const uintptr_t* args, uint8_t argCount);
+    void lock() const;
+    void unlock() const;
+
+    LogEntry _entries[CAPACITY];
+    uint32_t _next = 0;      // Sequence of the next entry recorded
+    uint32_t _drainNext = 0; // Sequence of the next entry written to Serial
+    uint32_t _dropped = 0;
+    volatile uint8_t _level = LOG_LEVEL_INFO;
+    static thread_local int _muted;
+    static void taskMain(void* arg);
+    mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    TaskHandle_t _handle = nullptr;
+    std::atomic<bool> _stopRequested{false};
+    std::atomic<bool> _taskRunning{false};
+};
+
+extern EventLog eventLog;
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) eventLog.record(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) eventLog.record(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) eventLog.record(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) eventLog.record(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,95 @@
+/**
+ * @file latency_stats.cpp
+ * @brief Latency histograms per web handler and control phase.
+ */
+
+#include "latency_stats.h"
+#include <string.h>
+
+LatencyStats latencyStats;
+
+void LatencyHistogram::record(uint32_t us) {
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+    counts[bucket]++;
+    samples++;
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+}
+
+void LatencyHistogram::reset() {
+    memset(counts, 0, sizeof(counts));
+    samples = 0;
+    maxUs = 0;
+    totalUs = 0;
+}
+
+uint32_t LatencyHistogram::percentileUs(uint8_t percent) const {
+    if (samples == 0) return 0;
+    uint64_t rank = ((uint64_t)samples * percent + 99) / 100; // Samples at or below the percentile
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS - 1; b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            uint32_t bound = 1UL << b;
+            return bound < maxUs ? bound : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+void LatencyStats::begin() {
+    setCpuClock(ESP.getCpuFreqMHz());
+}
+
+void LatencyStats::setCpuClock(uint32_t fixedMhz) {
+    uint32_t changes = (_timebase.load(std::memory_order_relaxed) >> 16) + 1;
+    _timebase.store((changes << 16) | (fixedMhz & 0xFFFF), std::memory_order_relaxed);
+}
+
+LatencyProbe* LatencyStats::probe(const char* name) {
+    for (int i = 0; i < _count; i++) {
+        if (strncmp(_probes[i].name, name, LatencyProbe::NAME_SIZE - 1) == 0) return &_probes[i];
+    }
+    if (_count >= MAX_PROBES) return nullptr;
+    LatencyProbe& added = _probes[_count++];
+    strncpy(added.name, name, LatencyProbe::NAME_SIZE - 1);
+    added.name[LatencyProbe::NAME_SIZE - 1] = '\0';
+    added.histogram.reset();
+    return &added;
+}
+
+void LatencyStats::reset() {
+    for (int i = 0; i < _count; i++) _probes[i].histogram.reset();
+}
+
+String LatencyStats::toJson() const {
+    String json = "{\"probes\":[";
+    for (int i = 0; i < _count; i++) {
+        const LatencyHistogram& h = _probes[i].histogram;
+        if (i > 0) json += ",";
+        json += "{\"name\":\"" + String(_probes[i].name) + "\"";
+        json += ",\"samples\":" + String(h.samples);
+        json += ",\"p50Us\":" + String(h.percentileUs(50));
+        json += ",\"p99Us\":" + String(h.percentileUs(99));
+        json += ",\"maxUs\":" + String(h.maxUs);
+        json += ",\"avgUs\":" + String(h.samples ? (uint32_t)(h.totalUs / h.samples) : 0);
+        json += "}";
+    }
+    json += "]}";
+    return json;
+}
+
+String LatencyStats::toText() const {
+    String text = "probe                            samples    p50us    p99us    maxus\n";
+    char line[96];
+    for (int i = 0; i < _count; i++) {
+        const LatencyHistogram& h = _probes[i].histogram;
+        snprintf(line, sizeof(line), "%-32s %7lu %8lu %8lu %8lu\n", _probes[i].name,
+                 (unsigned long)h.samples, (unsigned long)h.percentileUs(50),
+                 (unsigned long)h.percentileUs(99), (unsigned long)h.maxUs);
+        text += line;
+    }
+    return text;
+}
@@ -0,0 +1,95 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <atomic>
+#include <esp_timer.h>
+
+// Durations of one measured code section, in power-of-two microsecond buckets
+struct LatencyHistogram {
+    static const int BUCKETS = 20; // Bucket b counts durations below 2^b us; the last (>= 262 ms) is open
+    uint32_t counts[BUCKETS];
+    uint32_t samples;
+    uint32_t maxUs;
+    uint64_t totalUs;
+
+    void record(uint32_t us);
+    void reset();
+    // Upper bound of the bucket holding the given percentile (capped at maxUs); 0 without samples
+    uint32_t percentileUs(uint8_t percent) const;
+};
+
+struct LatencyProbe {
+    static const int NAME_SIZE = 32;
+    char name[NAME_SIZE];
+    LatencyHistogram histogram;
+};
+
+/**
+ * @brief Named latency histograms for web handlers, loop() work and the
+ * control passes.
+ *
+ * Probes are added during setup (probe() is not thread-safe) and each one is
+ * recorded by a single task, so recording takes no lock. Readers may see a
+ * probe mid-update from the other core; the numbers are for diagnosis only.
+ * Durations come from the CPU cycle counter (the measuring tasks are pinned,
+ * so start and end read the same core's counter) while the CPU clock is
+ * fixed, and from esp_timer while dynamic frequency scaling may change it
+ * under a measurement. The power policy announces clock changes with
+ * setCpuClock(); a measurement that spans one is dropped.
+ */
+class LatencyStats {
+public:
+    static const int MAX_PROBES = 48;
+
+    void begin();                      // Cycle timing at the current CPU clock
+    // The CPU now runs at a fixed fixedMhz, or scales on its own (0: time with esp_timer)
+    void setCpuClock(uint32_t fixedMhz);
+    LatencyProbe* probe(const char* name); // Find or add a probe; nullptr when MAX_PROBES are in use
+    int count() const { return _count; }
+    const LatencyProbe& at(int index) const { return _probes[index]; }
+    void reset();                      // Clear all histograms (probes stay registered)
+    String toJson() const;
+    String toText() const;             // One line per probe, for the serial console
+
+    // Clock in force: low 16 bits cycles per microsecond (0 = esp_timer microseconds),
+    // high 16 bits a change count, so both ends of a measurement can be compared
+    uint32_t timebase() const { return _timebase.load(std::memory_order_relaxed); }
+    static uint32_t now(uint32_t timebase) {
+        return (timebase & 0xFFFF) ? ESP.getCycleCount() : (uint32_t)esp_timer_get_time();
+    }
+    static uint32_t toMicros(uint32_t ticks, uint32_t timebase) {
+        uint32_t ticksPerUs = timebase & 0xFFFF;
+        return ticksPerUs ? ticks / ticksPerUs : ticks;
+    }
+
+private:
+    LatencyProbe _probes[MAX_PROBES];
+    int _count = 0;
+    std::atomic<uint32_t> _timebase{1};  // Written by the loop task only, read by every measuring task
+};
+
+extern LatencyStats latencyStats;
+
+// Records the time from construction to destruction in a probe (nullptr: not recorded)
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyProbe* probe)
+        : _probe(probe), _timebase(latencyStats.timebase()), _start(LatencyStats::now(_timebase)) {}
+    ~ScopedLatency() {
+        if (!_probe) return;
+        uint32_t elapsed = LatencyStats::now(_timebase) - _start;
+        if (latencyStats.timebase() != _timebase) return; // The clock changed while measuring
+        _probe->histogram.record(LatencyStats::toMicros(elapsed, _timebase));
+    }
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyProbe* _probe;
+    uint32_t _timebase;
+    uint32_t _start;
+};
+
+#endif // LATENCY_STATS_H
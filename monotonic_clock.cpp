@@ -0,0 +1,39 @@
+/**
+ * @file monotonic_clock.cpp
+ * @brief 64-bit monotonic millisecond clock with a manual mode for simulations.
+ */
+
+#include "monotonic_clock.h"
+
+#include <esp_timer.h>
+
+// Per thread: manual time never leaks into other tasks
+static thread_local bool manualMode = false;
+static thread_local uint64_t manualNowMs = 0;
+
+uint64_t MonotonicClock::nowMs() {
+    if (manualMode) return manualNowMs;
+    return (uint64_t)esp_timer_get_time() / 1000;
+}
+
+uint64_t MonotonicClock::nowMicros() {
+    if (manualMode) return manualNowMs * 1000;
+    return (uint64_t)esp_timer_get_time();
+}
+
+void MonotonicClock::setManual(uint64_t atMs) {
+    manualNowMs = atMs;
+    manualMode = true;
+}
+
+void MonotonicClock::advance(uint64_t ms) {
+    manualNowMs += ms;
+}
+
+void MonotonicClock::useSystem() {
+    manualMode = false;
+}
+
+bool MonotonicClock::isManual() {
+    return manualMode;
+}
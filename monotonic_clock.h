@@ -0,0 +1,30 @@
+#ifndef MONOTONIC_CLOCK_H
+#define MONOTONIC_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * @brief Milliseconds since boot as a 64-bit count, for every run sequencer.
+ *
+ * millis() is 32 bits and wraps after 49.7 days; this clock does not wrap
+ * (it reads esp_timer), so deadlines and elapsed times can be compared and
+ * subtracted directly. Simulations can switch to manual time, which stands
+ * still until advance() moves it.
+ * Manual time applies to the calling thread (task) only, so a simulation can
+ * run next to the live control task. Wall-clock time is in WallClock.
+ */
+class MonotonicClock {
+public:
+    static uint64_t nowMs();
+    static uint64_t nowMicros(); // Same clock in microseconds (nowMs() is this / 1000)
+
+    // Simulation: stop following the hardware clock and start at atMs
+    static void setManual(uint64_t atMs);
+    // Move manual time forward (no effect while following the hardware clock)
+    static void advance(uint64_t ms);
+    // Follow the hardware clock again
+    static void useSystem();
+    static bool isManual();
+};
+
+#endif // MONOTONIC_CLOCK_H
@@ -0,0 +1,109 @@
+/**
+ * @file occupancy_index.cpp
+ * @brief Minute-of-week occupancy bitmap for fast "is on" checks and range queries.
+ */
+
+#include "occupancy_index.h"
+#include <string.h>
+
+OccupancyIndex::OccupancyIndex() : _bits(nullptr), _zoneCount(0) {}
+
+OccupancyIndex::~OccupancyIndex() {
+    delete[] _bits;
+}
+
+void OccupancyIndex::begin(int zoneCount) {
+    delete[] _bits;
+    _zoneCount = zoneCount;
+    _bits = new uint32_t[zoneCount * WORDS_PER_ZONE];
+    clear();
+}
+
+void OccupancyIndex::clear() {
+    if (_bits) memset(_bits, 0, sizeof(uint32_t) * _zoneCount * WORDS_PER_ZONE);
+}
+
+void OccupancyIndex::clearZone(int zone) {
+    if (zone < 0 || zone >= _zoneCount) return;
+    memset(_bits + zone * WORDS_PER_ZONE, 0, sizeof(uint32_t) * WORDS_PER_ZONE);
+}
+
+int OccupancyIndex::wrap(int minute) {
+    minute %= MINUTES_PER_WEEK;
+    return minute < 0 ? minute + MINUTES_PER_WEEK : minute;
+}
+
+void OccupancyIndex::setRange(int zone, int startMinute, int lengthMinutes) {
+    if (zone < 0 || zone >= _zoneCount || lengthMinutes <= 0) return;
+    if (lengthMinutes > MINUTES_PER_WEEK) lengthMinutes = MINUTES_PER_WEEK;
+    uint32_t* bits = _bits + zone * WORDS_PER_ZONE;
+    int pos = wrap(startMinute);
+    while (lengthMinutes > 0) {
+        int bit = pos & 31;
+        int span = 32 - bit;
+        if (span > lengthMinutes) span = lengthMinutes;
+        if (span > MINUTES_PER_WEEK - pos) span = MINUTES_PER_WEEK - pos;
+        uint32_t mask = (span == 32) ? 0xFFFFFFFFu : (((1u << span) - 1) << bit);
+        bits[pos >> 5] |= mask;
+        lengthMinutes -= span;
+        pos = wrap(pos + span);
+    }
+}
+
+bool OccupancyIndex::isOn(int zone, int minuteOfWeek) const {
+    if (zone < 0 || zone >= _zoneCount) return false;
+    int pos = wrap(minuteOfWeek);
+    return (row(zone)[pos >> 5] >> (pos & 31)) & 1u;
+}
+
+// Word-wise popcount over a (possibly wrapping) range; optionally stop at the first set bit
+int OccupancyIndex::scanRange(int zone, int startMinute, int lengthMinutes, bool stopAtFirst) const {
+    if (zone < 0 || zone >= _zoneCount || lengthMinutes <= 0) return 0;
+    if (lengthMinutes > MINUTES_PER_WEEK) lengthMinutes = MINUTES_PER_WEEK;
+    const uint32_t* bits = row(zone);
+    int pos = wrap(startMinute);
+    int total = 0;
+    while (lengthMinutes > 0) {
+        int bit = pos & 31;
+        int span = 32 - bit;
+        if (span > lengthMinutes) span = lengthMinutes;
+        if (span > MINUTES_PER_WEEK - pos) span = MINUTES_PER_WEEK - pos;
+        uint32_t word = bits[pos >> 5] >> bit;
+        if (span < 32) word &= (1u << span) - 1;
+        if (word) {
+            if (stopAtFirst) return 1;
+            total += __builtin_popcount(word);
+        }
+        lengthMinutes -= span;
+        pos = wrap(pos + span);
+    }
+    return total;
+}
+
+bool OccupancyIndex::anyInRange(int zone, int startMinute, int lengthMinutes) const {
+    return scanRange(zone, startMinute, lengthMinutes, true) > 0;
+}
+
+int OccupancyIndex::countInRange(int zone, int startMinute, int lengthMinutes) const {
+    return scanRange(zone, startMinute, lengthMinutes, false);
+}
+
+int OccupancyIndex::nextChange(int zone, int minuteOfWeek) const {
+    if (zone < 0 || zone >= _zoneCount) return -1;
+    const uint32_t* bits = row(zone);
+    int origin = wrap(minuteOfWeek);
+    // XOR against the current state so any set bit marks a change
+    uint32_t invert = isOn(zone, origin) ? 0xFFFFFFFFu : 0;
+    int scanned = 1;
+    while (scanned < MINUTES_PER_WEEK) {
+        int pos = wrap(origin + scanned);
+        int bit = pos & 31;
+        int span = 32 - bit;
+        if (span > MINUTES_PER_WEEK - scanned) span = MINUTES_PER_WEEK - scanned;
+        uint32_t word = (bits[pos >> 5] ^ invert) >> bit;
+        if (span < 32) word &= (1u << span) - 1;
+        if (word) return scanned + __builtin_ctz(word);
+        scanned += span;
+    }
+    return -1;
+}
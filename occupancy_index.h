@@ -0,0 +1,51 @@
+#ifndef OCCUPANCY_INDEX_H
+#define OCCUPANCY_INDEX_H
+
+#include <stdint.h>
+
+/**
+ * @brief Minute-of-week occupancy bitmap, one 10,080-bit row per zone.
+ *
+ * Bit m of a zone's row is set when the zone is scheduled to run during minute m
+ * of the week (0 = Monday 00:00). "Is zone z on now" is one bit test and range
+ * queries scan 32 minutes per word. The rows cover a single calendar week:
+ * ScheduleManager clips runs at Sunday 23:59 rather than wrapping them onto Monday,
+ * and fills Monday's early minutes from the previous Sunday's runs instead. Only the
+ * minute arithmetic here is modular, so query ranges may still cross the week end.
+ */
+class OccupancyIndex {
+public:
+    static const int MINUTES_PER_WEEK = 7 * 1440;
+    static const int WORDS_PER_ZONE = MINUTES_PER_WEEK / 32; // 10080 is a multiple of 32
+
+    OccupancyIndex();
+    ~OccupancyIndex();
+    void begin(int zoneCount);          // Allocate rows for zoneCount zones (all clear)
+    void clear();                       // Clear every zone's row
+    void clearZone(int zone);           // Clear one zone's row
+    int getZoneCount() const { return _zoneCount; }
+
+    // Mark [startMinute, startMinute + lengthMinutes) as occupied for a zone
+    void setRange(int zone, int startMinute, int lengthMinutes);
+    // True if the zone is scheduled during the given minute of the week
+    bool isOn(int zone, int minuteOfWeek) const;
+    // True if the zone is scheduled at any minute in [startMinute, startMinute + lengthMinutes)
+    bool anyInRange(int zone, int startMinute, int lengthMinutes) const;
+    // Number of scheduled minutes for the zone in [startMinute, startMinute + lengthMinutes)
+    int countInRange(int zone, int startMinute, int lengthMinutes) const;
+    // Minutes until the zone's on/off state differs from minuteOfWeek, or -1 if it never changes
+    int nextChange(int zone, int minuteOfWeek) const;
+
+    static int minuteOfWeek(int dayOfWeek, int minuteOfDay) {
+        return dayOfWeek * 1440 + minuteOfDay;
+    }
+private:
+    const uint32_t* row(int zone) const { return _bits + zone * WORDS_PER_ZONE; }
+    static int wrap(int minute);
+    int scanRange(int zone, int startMinute, int lengthMinutes, bool stopAtFirst) const;
+
+    uint32_t* _bits;
+    int _zoneCount;
+};
+
+#endif // OCCUPANCY_INDEX_H
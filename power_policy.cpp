@@ -0,0 +1,120 @@
+/**
+ * @file power_policy.cpp
+ * @brief Idle power states chosen from the next schedule event and recent activity.
+ */
+
+#include "power_policy.h"
+#include "latency_stats.h"
+
+#include <esp_idf_version.h>
+#include <esp_pm.h>
+#include <esp_wifi.h>
+
+PowerPolicy powerPolicy;
+
+const uint32_t PowerPolicy::LOOP_DELAY_MS[(int)PowerState::COUNT] = {5, 20, 100};
+const uint32_t PowerPolicy::CONTROL_PERIOD_MS[(int)PowerState::COUNT] = {5, 50, 200};
+
+PowerState PowerPolicy::decide(const PowerInputs& inputs) const {
+    if (!_enabled || inputs.zonesRunning || inputs.networkBusy) return PowerState::Active;
+    uint64_t quietMs = inputs.nowMs > _lastActivityMs ? inputs.nowMs - _lastActivityMs : 0;
+    if (quietMs < ACTIVE_HOLD_MS) return PowerState::Active;
+    bool eventKnown = inputs.msToNextEvent >= 0;
+    if (eventKnown && inputs.msToNextEvent <= (int64_t)WAKE_AHEAD_MS) return PowerState::Active;
+    if (!_lightSleepRefused && quietMs >= LIGHT_SLEEP_AFTER_MS &&
+        (!eventKnown || inputs.msToNextEvent >= (int64_t)LIGHT_SLEEP_MIN_LEAD_MS)) {
+        return PowerState::LightSleep;
+    }
+    return PowerState::Idle;
+}
+
+void PowerPolicy::apply(PowerState state, uint64_t nowMs) {
+    if (state == _state) return;
+    if (!enterState(state)) {
+        // Build without automatic light sleep: stay in (or go to) Idle from now on
+        _lightSleepRefused = true;
+        state = PowerState::Idle;
+        if (state == _state) return;
+        enterState(state);
+    }
+    _timeInStateMs[(int)_state] += nowMs > _stateSinceMs ? nowMs - _stateSinceMs : 0;
+    _stateSinceMs = nowMs;
+    _state = state;
+    _entries[(int)state]++;
+}
+
+PowerState PowerPolicy::update(const PowerInputs& inputs) {
+    apply(decide(inputs), inputs.nowMs);
+    return _state;
+}
+
+uint64_t PowerPolicy::timeInStateMs(PowerState state, uint64_t nowMs) const {
+    uint64_t total = _timeInStateMs[(int)state];
+    if (state == _state && nowMs > _stateSinceMs) total += nowMs - _stateSinceMs;
+    return total;
+}
+
+// CPU clock, WiFi power save and automatic light sleep for a state; false if the build
+// refuses light sleep (needs CONFIG_PM_ENABLE and tickless idle)
+bool PowerPolicy::enterState(PowerState state) {
+    bool lowPower = state != PowerState::Active;
+    uint32_t cpuMhz = lowPower ? IDLE_CPU_MHZ : ACTIVE_CPU_MHZ;
+    uint32_t fixedMhz = cpuMhz;
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t config = {};
+#else
+    esp_pm_config_esp32_t config = {};
+#endif
+    config.max_freq_mhz = cpuMhz;
+    config.min_freq_mhz = state == PowerState::LightSleep ? 40 : cpuMhz; // XTAL clock while waiting
+    config.light_sleep_enable = state == PowerState::LightSleep;
+    // Latency probes time with esp_timer while the clock changes; one spanning it is dropped
+    latencyStats.setCpuClock(0);
+    if (esp_pm_configure(&config) != ESP_OK) {
+        if (state == PowerState::LightSleep) {
+            latencyStats.setCpuClock(ESP.getCpuFreqMHz()); // Refused: the fixed clock stays
+            return false;
+        }
+        setCpuFrequencyMhz(cpuMhz);
+    } else if (state == PowerState::LightSleep) {
+        fixedMhz = 0; // Frequency scaling: cycle counts no longer convert to time
+    }
+#else
+    if (state == PowerState::LightSleep) return false;
+    latencyStats.setCpuClock(0);
+    setCpuFrequencyMhz(cpuMhz);
+#endif
+    latencyStats.setCpuClock(fixedMhz);
+    // Modem sleep wakes for every DTIM beacon, so the station stays associated and reachable
+    esp_wifi_set_ps(lowPower ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+    return true;
+}
+
+String PowerPolicy::toJson(uint64_t nowMs) const {
+    String json = "{";
+    json += "\"enabled\":" + String(_enabled ? "true" : "false");
+    json += ",\"state\":\"" + String(stateName(_state)) + "\"";
+    json += ",\"cpuMhz\":" + String((unsigned)ESP.getCpuFreqMHz());
+    json += ",\"lightSleepAvailable\":" + String(_lightSleepRefused ? "false" : "true");
+    json += ",\"loopDelayMs\":" + String(loopDelayMs());
+    json += ",\"states\":{";
+    for (int s = 0; s < (int)PowerState::COUNT; s++) {
+        if (s > 0) json += ",";
+        json += "\"" + String(stateName((PowerState)s)) + "\":{";
+        json += "\"ms\":" + String((unsigned long long)timeInStateMs((PowerState)s, nowMs));
+        json += ",\"entries\":" + String(_entries[s]);
+        json += "}";
+    }
+    json += "}}";
+    return json;
+}
+
+const char* PowerPolicy::stateName(PowerState state) {
+    switch (state) {
+    case PowerState::Active: return "active";
+    case PowerState::Idle: return "idle";
+    case PowerState::LightSleep: return "lightSleep";
+    default: return "?";
+    }
+}
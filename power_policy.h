@@ -0,0 +1,79 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <Arduino.h>
+
+// How hard the controller runs between watering events
+enum class PowerState : uint8_t {
+    Active,     // Full CPU clock, WiFi always on, loop() every 5 ms
+    Idle,       // Reduced CPU clock, WiFi modem sleep, slower loop() and control passes
+    LightSleep, // Idle plus automatic light sleep between FreeRTOS ticks (when the build allows it)
+    COUNT
+};
+
+// What the policy looks at on each decision (filled in by loop())
+struct PowerInputs {
+    uint64_t nowMs;          // MonotonicClock time
+    bool zonesRunning;       // A relay is on, or a Quick Run / Run Program Now / manual mode is active
+    bool networkBusy;        // Boot not finished (WiFi connecting, AP mode)
+    int64_t msToNextEvent;   // Until the next schedule transition (-1 = unknown, e.g. no valid clock)
+};
+
+/**
+ * @brief Picks a power state from the next known event and recent activity.
+ *
+ * Runs Active while zones run, during boot, within ACTIVE_HOLD_MS of a web
+ * request or OTA transfer, and from WAKE_AHEAD_MS before the next schedule
+ * transition. Otherwise it drops to Idle, and after LIGHT_SLEEP_AFTER_MS
+ * without activity, with the next event at least LIGHT_SLEEP_MIN_LEAD_MS
+ * away, to LightSleep. WiFi stays associated in both (DTIM modem sleep), so a
+ * request is answered within about one DTIM period plus loopDelayMs(); the
+ * request itself switches back to Active for the ones that follow.
+ * decide() only reads its inputs; apply() switches the clocks and WiFi.
+ */
+class PowerPolicy {
+public:
+    static const uint32_t ACTIVE_HOLD_MS = 30000;            // Stay Active after a request or OTA packet
+    static const uint32_t WAKE_AHEAD_MS = 5000;              // Active this long before a schedule transition
+    static const uint32_t LIGHT_SLEEP_AFTER_MS = 120000;     // Idle with no activity this long before LightSleep
+    static const uint32_t LIGHT_SLEEP_MIN_LEAD_MS = 60000;   // LightSleep only if the next event is this far away
+    static const uint32_t ACTIVE_CPU_MHZ = 240;
+    static const uint32_t IDLE_CPU_MHZ = 80;                 // Lowest clock WiFi runs at
+    static const uint32_t LOOP_DELAY_MS[(int)PowerState::COUNT];     // loop() delay per state
+    static const uint32_t CONTROL_PERIOD_MS[(int)PowerState::COUNT]; // Control pass period per state
+
+    PowerState decide(const PowerInputs& inputs) const;
+    // Switch to state (CPU clock, WiFi power save, light sleep) and account the time spent in the old one
+    void apply(PowerState state, uint64_t nowMs);
+    // One decide() + apply(); returns the state now in force
+    PowerState update(const PowerInputs& inputs);
+
+    void noteActivity(uint64_t nowMs) { _lastActivityMs = nowMs; } // Web request or OTA packet (loop task)
+    uint64_t lastActivityMs() const { return _lastActivityMs; }    // 0 = none since boot
+    void setEnabled(bool enabled) { _enabled = enabled; }          // Disabled: always Active
+    bool isEnabled() const { return _enabled; }
+    PowerState state() const { return _state; }
+    uint32_t loopDelayMs() const { return LOOP_DELAY_MS[(int)_state]; }
+    uint32_t controlPeriodMs() const { return CONTROL_PERIOD_MS[(int)_state]; }
+
+    uint64_t timeInStateMs(PowerState state, uint64_t nowMs) const; // Including the current stretch
+    uint32_t entries(PowerState state) const { return _entries[(int)state]; }
+    String toJson(uint64_t nowMs) const;
+
+    static const char* stateName(PowerState state);
+
+private:
+    bool enterState(PowerState state);
+
+    bool _enabled = true;
+    PowerState _state = PowerState::Active;
+    uint64_t _stateSinceMs = 0;
+    uint64_t _lastActivityMs = 0;
+    uint64_t _timeInStateMs[(int)PowerState::COUNT] = {};
+    uint32_t _entries[(int)PowerState::COUNT] = {1, 0, 0}; // Active since boot
+    bool _lightSleepRefused = false;  // The build has no automatic light sleep: Idle instead
+};
+
+extern PowerPolicy powerPolicy;
+
+#endif // POWER_POLICY_H
@@ -11,9 +11,65 @@
 #include "program_page.h"
 #include "webserver.h"
 #include "schedule.h"
+#include "control_task.h"
+#include "wall_clock.h"
 #include <WebServer.h>
 #include <ArduinoJson.h>
 
+// Everything the Edit Programs page shows from the schedule manager, copied under
+// ControlLock so the page is rendered without holding up the control task
+struct ProgramPageState {
+    struct Zone {
+        bool disabled;
+        uint16_t maxCycleMinutes;
+        uint16_t minSoakMinutes;
+        uint16_t flowRate;
+    };
+    int count;
+    bool stackPrograms;
+    int maxOpenValves;
+    uint16_t supplyCapacity;
+    uint16_t waterBudgetPercent;
+    uint16_t monthlyBudgetPercent[12];
+    Zone zones[MAX_ZONES];
+    Program programs[NUM_PROGRAMS];
+    uint32_t scheduledNowMask[NUM_PROGRAMS];     // Zones whose current interval belongs to the program
+    int zoneEndOffset[NUM_PROGRAMS][MAX_ZONES];  // End of each zone's last cycle, minutes after a start
+    int packedMinutes[NUM_PROGRAMS];
+    int sequentialMinutes[NUM_PROGRAMS];
+};
+
+static void captureProgramPageState(ScheduleManager& scheduleManager, int nowMinute, ProgramPageState& state) {
+    ControlLock lock;
+    state.count = scheduleManager.count;
+    state.stackPrograms = scheduleManager.stackPrograms;
+    state.maxOpenValves = scheduleManager.maxOpenValves;
+    state.supplyCapacity = scheduleManager.supplyCapacity;
+    state.waterBudgetPercent = scheduleManager.waterBudgetPercent;
+    memcpy(state.monthlyBudgetPercent, scheduleManager.monthlyBudgetPercent, sizeof(state.monthlyBudgetPercent));
+    for (int z = 0; z < state.count; z++) {
+        const Sprinkler& sprinkler = scheduleManager.sprinklers[z];
+        state.zones[z] = {sprinkler.disabled, sprinkler.maxCycleMinutes, sprinkler.minSoakMinutes, sprinkler.flowRate};
+    }
+    const ScheduleTable& table = scheduleManager.activeSchedule();
+    ZoneRun layout[ScheduleManager::MAX_RUNS_PER_START];
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        state.programs[p] = scheduleManager.programs[p];
+        state.scheduledNowMask[p] = 0;
+        for (int z = 0; z < state.count; z++) {
+            int i = table.findInterval(z, ScheduleManager::HORIZON_TODAY + nowMinute);
+            if (i >= 0 && table.zoneIntervals(z)[i].programIndex == p) state.scheduledNowMask[p] |= 1UL << z;
+            state.zoneEndOffset[p][z] = 0;
+        }
+        int numLayout = scheduleManager.layoutProgramStart(p, 0, 0, layout);
+        for (int r = 0; r < numLayout; r++) {
+            int end = layout[r].startMinute + layout[r].duration;
+            if (end > state.zoneEndOffset[p][layout[r].zone]) state.zoneEndOffset[p][layout[r].zone] = end;
+        }
+        scheduleManager.programWindowMinutes(p, state.packedMinutes[p], state.sequentialMinutes[p]);
+    }
+}
+
 /**
  * handleProgramPage
  *
@@ -25,6 +81,13 @@
  * @param scheduleManager Reference to the schedule manager (holds all program and zone state)
  */
 void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
+    // Static: only the web server (loop task) renders this page, and it keeps the copy off that task's stack
+    static ProgramPageState state;
+    struct tm nowInfo;
+    WallClock::localNow(nowInfo);
+    captureProgramPageState(scheduleManager, nowInfo.tm_hour * 60 + nowInfo.tm_min, state);
+    ControlSnapshot snapshot = controlSnapshot();
+
     String html = R"rawliteral(
 <!DOCTYPE html>
 <html>
@@ -79,8 +142,8 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
     html += "</div>";
     // Sprinkler enable/disable buttons at the top
     html += "<div style='margin-bottom:15px;'><strong>Disable Sprinklers:</strong> ";
-    for (int s = 0; s < scheduleManager.count; s++) {
-        bool isDisabled = scheduleManager.sprinklers[s].disabled;
+    for (int s = 0; s < state.count; s++) {
+        bool isDisabled = state.zones[s].disabled;
         html += "<button type='button' class='sprinkler-disable-btn";
         if (isDisabled) html += " disabled-btn";
         html += "' onclick='toggleSprinkler(this, " + String(s) + ")' id='sprinklerBtn" + String(s) + "'>";
@@ -91,28 +154,64 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
     html += "</div>";
     html += "<form id='programForm' action='/save_programs' method='POST'>";
 
+    // Program stacking: queue overlapping programs instead of opening valves together
+    html += "<div style='margin-bottom:15px;'><strong>Overlapping Programs:</strong> ";
+    html += "<label><input type='checkbox' name='stack_programs' " + String(state.stackPrograms ? "checked" : "") +
+            "> Stack (run one after another)</label> ";
+    html += "Max valves open at once: <input type='number' class='duration-input' name='max_open_valves' value='" +
+            String(state.maxOpenValves) + "' min='1' max='" + String(MAX_ZONES) + "'>";
+    html += "</div>";
+
+    // Seasonal water budget: scales every duration without changing the stored programs
+    static const char* const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    html += "<div style='margin-bottom:15px;'><strong>Water Budget:</strong> ";
+    html += "<input type='number' class='duration-input' name='budget_percent' value='" + String(state.waterBudgetPercent) +
+            "' min='0' max='" + String(ScheduleManager::MAX_BUDGET_PERCENT) + "'>% &nbsp; Monthly %:";
+    for (int m = 0; m < 12; m++) {
+        html += " " + String(months[m]) + " <input type='number' class='duration-input' name='budget_month_" + String(m) +
+                "' value='" + String(state.monthlyBudgetPercent[m]) + "' min='0' max='" +
+                String(ScheduleManager::MAX_BUDGET_PERCENT) + "'>";
+    }
+    html += "</div>";
+
+    // Cycle and soak: split long zone runs and let other zones water during the soak.
+    // Flow budget: run zones together while their combined flow fits the supply.
+    html += "<div style='margin-bottom:15px;'><strong>Zone Settings</strong> (0 = off/unknown)";
+    html += " Supply capacity (L/min): <input type='number' class='duration-input' name='supply_capacity' value='" +
+            String(state.supplyCapacity) + "' min='0' max='10000'>";
+    html += "<table><tr><th>Zone</th><th>Max cycle (minutes)</th><th>Min soak (minutes)</th><th>Flow (L/min)</th></tr>";
+    for (int z = 0; z < state.count; z++) {
+        html += "<tr><td>Zone " + String(z + 1) + "</td>";
+        html += "<td><input type='number' class='duration-input' name='zone_" + String(z) + "_cycle' value='" +
+                String(state.zones[z].maxCycleMinutes) + "' min='0' max='240'></td>";
+        html += "<td><input type='number' class='duration-input' name='zone_" + String(z) + "_soak' value='" +
+                String(state.zones[z].minSoakMinutes) + "' min='0' max='240'></td>";
+        html += "<td><input type='number' class='duration-input' name='zone_" + String(z) + "_flow' value='" +
+                String(state.zones[z].flowRate) + "' min='0' max='10000'></td></tr>";
+    }
+    html += "</table></div>";
+
     // Add each program section
     const char* days[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
-    const char* programNames[] = {"A", "B", "C"};
     
-    for (int p = 0; p < 3; p++) {
-        Program& prog = scheduleManager.programs[p];
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        const Program& prog = state.programs[p];
         
         html += "<div class='program-container " + String(prog.enabled ? "program-enabled" : "program-disabled") + "'>";
-        html += "<div class='program-header'>Program " + String(programNames[p]) + "</div>";
+        html += "<div class='program-header'>Program " + String(programLetter(p)) + "</div>";
 
         // --- Copy From Buttons ---
         html += "<div style='margin-bottom:10px;display:flex;align-items:center;gap:10px;'>";
         html += "<span>Copy From: ";
-        for (int other = 0; other < 3; other++) {
+        for (int other = 0; other < NUM_PROGRAMS; other++) {
             if (other == p) continue;
-            html += "<button type='button' class='copy-btn' onclick='copyProgram(" + String(p) + "," + String(other) + ")'>Program " + String(programNames[other]) + "</button> ";
+            html += "<button type='button' class='copy-btn' onclick='copyProgram(" + String(p) + "," + String(other) + ")'>Program " + String(programLetter(other)) + "</button> ";
         }
         html += "</span>";
         // --- Clear All Times Button ---
         html += "<button type='button' class='clear-btn' onclick='clearAllTimes(" + String(p) + ")' style='background:#f44336;color:white;padding:6px 12px;border:none;border-radius:4px;cursor:pointer;'>Clear All Times</button>";
         // --- Run Program Now Toggle Button ---
-        if (scheduleManager.runProgramNowActive && scheduleManager.currentRunNowProgramIndex == p) {
+        if (snapshot.runProgramNowIndex == p) {
             html += "<button type='button' class='run-now-btn' onclick='stopProgramNow(" + String(p) + ")' style='background:#f44336;color:white;padding:6px 12px;border:none;border-radius:4px;cursor:pointer;'>Stop Program Now</button>";
         } else {
             html += "<button type='button' class='run-now-btn' onclick='runProgramNow(" + String(p) + ")' style='background:#4CAF50;color:white;padding:6px 12px;border:none;border-radius:4px;cursor:pointer;'>Run Program Now</button>";
@@ -126,9 +225,14 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
         html += "<label><input type='checkbox' name='prog_" + String(p) + "_enabled' " +
                 (prog.enabled ? "checked" : "") + "> Enable Program</label><br><br>";
         
-        // Start time
-        html += "Start Time: <input type='time' class='time-input' name='prog_" + String(p) + "_start' " +
-                "value='" + prog.startTime + "'><br><br>";
+        // Start times (leave blank to skip)
+        html += "Start Times:";
+        for (int k = 0; k < MAX_START_TIMES; k++) {
+            String startValue = prog.startTimes[k] < 1440 ? formatMinuteOfDay(prog.startTimes[k]) : "";
+            html += " <input type='time' class='time-input' name='prog_" + String(p) + "_start_" + String(k) + "' " +
+                    "value='" + startValue + "'>";
+        }
+        html += "<br><br>";
         
         // Days of week
         html += "<div class='days-container'>Run on:";
@@ -141,25 +245,35 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
                    "value='" + String(prog.daysOfWeek[d] ? "1" : "0") + "'>";
         }
         html += "</div>";
+
+        // Recurrence: weekdays above, every N days, or odd/even calendar days
+        static const char* const recurrences[RECUR_TYPE_COUNT] = {"Selected weekdays", "Every N days", "Odd days", "Even days"};
+        html += "<div>Repeat: <select name='prog_" + String(p) + "_recur'>";
+        for (int r = 0; r < RECUR_TYPE_COUNT; r++) {
+            html += "<option value='" + String(r) + "'" + (prog.recurrence == r ? " selected" : "") + ">" + recurrences[r] + "</option>";
+        }
+        html += "</select> N = <input type='number' class='duration-input' name='prog_" + String(p) + "_every' value='" +
+                String(prog.intervalDays) + "' min='1' max='30'>";
+        html += " starting <input type='date' name='prog_" + String(p) + "_anchor' value='" + formatEpochDay(prog.intervalAnchorDay) + "'>";
+        // Upcoming run days
+        int32_t upcoming[5];
+        int numUpcoming = forecastRunDays(prog, epochDayFromTm(nowInfo), upcoming, 5);
+        html += " &nbsp; Next: ";
+        for (int i = 0; i < numUpcoming; i++) {
+            html += (i ? ", " : "") + formatEpochDay(upcoming[i]);
+        }
+        if (numUpcoming == 0) html += "-";
+        html += "</div>";
         
         // Zone durations table
         html += "<table><tr><th>Zone</th><th style='text-align:center;'>Duration (minutes)</th><th>End Time</th></tr>";
-        // Determine if this program is currently running
-        bool isProgramRunning = false;
-        for (int z2 = 0; z2 < scheduleManager.count; z2++) {
-            if (scheduleManager.sprinklers[z2].state && scheduleManager.sprinklers[z2].calculatedSchedules[p].programIndex == p) {
-                isProgramRunning = true;
-                break;
-            }
-        }
-        // Track running end time for enabled zones only
-        int currentHour = prog.startTime.substring(0, 2).toInt();
-        int currentMin = prog.startTime.substring(3, 5).toInt();
-        for (int z = 0; z < scheduleManager.count; z++) {
-            bool isDisabled = scheduleManager.sprinklers[z].disabled;
+        // Zones switched on right now for this program
+        uint32_t runningZones = snapshot.zoneOnMask & state.scheduledNowMask[p];
+        for (int z = 0; z < state.count; z++) {
+            bool isDisabled = state.zones[z].disabled;
             String rowClass = isDisabled ? " style='background-color:#e0e0e0;opacity:0.6;'" : "";
             // Highlight only if this zone is enabled and ON for the running program
-            bool zoneActive = isProgramRunning && !isDisabled && scheduleManager.sprinklers[z].state && scheduleManager.sprinklers[z].calculatedSchedules[p].programIndex == p;
+            bool zoneActive = !isDisabled && ((runningZones >> z) & 1);
             String zoneClass = zoneActive ? " class='prog-edit-zone-active'" : "";
             html += "<tr data-zone='" + String(z) + "'" + rowClass + "><td id='zoneName_" + String(p) + "_" + String(z) + "'>Zone " + String(z + 1) + "</td>"; // The real-time poll will add 'prog-edit-zone-active' class if needed
             html += "<td style='text-align:center;'>";
@@ -173,26 +287,30 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
             // Show calculated end time for this zone/program
             String endTimeDisplay = "-";
             if (!isDisabled && prog.durations[z] > 0) {
-                // Calculate end time for enabled zone
-                int zoneDuration = prog.durations[z];
-                int endHour = currentHour;
-                int endMin = currentMin + zoneDuration;
-                endHour += endMin / 60;
-                endMin = endMin % 60;
-                // Format as 12-hour time
-                int displayHour = endHour % 12;
-                if (displayHour == 0) displayHour = 12;
-                String ampm = (endHour >= 12 && endHour < 24) ? "PM" : "AM";
-                endTimeDisplay = String(displayHour) + ":" + (endMin < 10 ? "0" : "") + String(endMin) + " " + ampm;
-                // Advance current time for next zone
-                currentHour = endHour;
-                currentMin = endMin;
+                // Calculate end time for enabled zone, once per configured start
+                String ends = "";
+                for (int k = 0; k < MAX_START_TIMES; k++) {
+                    if (prog.startTimes[k] >= 1440) continue;
+                    int endTotal = (prog.startTimes[k] + state.zoneEndOffset[p][z]) % 1440;
+                    int endHour = endTotal / 60;
+                    int endMin = endTotal % 60;
+                    // Format as 12-hour time
+                    int displayHour = endHour % 12;
+                    if (displayHour == 0) displayHour = 12;
+                    String ampm = endHour >= 12 ? "PM" : "AM";
+                    if (ends.length() > 0) ends += ", ";
+                    ends += String(displayHour) + ":" + (endMin < 10 ? "0" : "") + String(endMin) + " " + ampm;
+                }
+                if (ends.length() > 0) endTimeDisplay = ends;
             }
             html += "<td style='text-align:left; padding-left:0;'>" + endTimeDisplay + "</td></tr>";
         }
         html += "</table>";
+        // Watering window per start: cycle-and-soak/flow packing vs. running each zone's cycles in turn
+        html += "<div>Watering window: " + String(state.packedMinutes[p]) + " min packed (" +
+                String(state.sequentialMinutes[p]) + " min sequential)</div>";
         // Add Save Program X button
-        html += "<button type='submit' name='save_program' value='" + String(p) + "' class='save-btn'>Save Program " + String(programNames[p]) + "</button>";
+        html += "<button type='submit' name='save_program' value='" + String(p) + "' class='save-btn'>Save Program " + String(programLetter(p)) + "</button>";
         // Add Return to Main Page button
         html += "<a href='/' class='save-btn' style='margin-left:15px;background-color:#2196F3;'>Return to Main Page</a>";
         html += "</div>";
@@ -223,7 +341,7 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
         /**
          * runProgramNow
          * Sets the program's start time to the current time, enables it, and submits the form.
-         * @param progIdx Program index (0=A, 1=B, 2=C)
+         * @param progIdx Program index (0=A, 1=B, ...)
          */
         function runProgramNow(progIdx) {
             fetch('/run_now', {
@@ -241,7 +359,7 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
         /**
          * clearAllTimes
          * Sets all zone duration inputs for the given program to zero.
-         * @param progIdx Program index (0=A, 1=B, 2=C)
+         * @param progIdx Program index (0=A, 1=B, ...)
          */
         function clearAllTimes(progIdx) {
             const inputs = document.querySelectorAll(`input[name^='prog_${progIdx}_dur_']`);
@@ -257,7 +375,7 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
          */
         function copyProgram(target, source) {
             if (target === source) return;
-            if (!confirm('Are you sure you want to overwrite Program ' + ['A','B','C'][target] + ' with Program ' + ['A','B','C'][source] + '?')) return;
+            if (!confirm('Are you sure you want to overwrite Program ' + String.fromCharCode(65 + target) + ' with Program ' + String.fromCharCode(65 + source) + '?')) return;
             // Copy durations from source to target in the UI
             for (let z = 0; ; z++) {
                 let sourceInput = document.querySelector(`input[name='prog_${source}_dur_${z}']`);
@@ -378,7 +496,7 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
     }
     function copyProgram(target, source) {
         if (target === source) return;
-        if (!confirm('Are you sure you want to overwrite Program ' + ['A','B','C'][target] + ' with Program ' + ['A','B','C'][source] + '?')) return;
+        if (!confirm('Are you sure you want to overwrite Program ' + String.fromCharCode(65 + target) + ' with Program ' + String.fromCharCode(65 + source) + '?')) return;
         // Copy durations from source to target in the UI
         for (let z = 0; ; z++) {
             let sourceInput = document.querySelector(`input[name='prog_${source}_dur_${z}']`);
@@ -397,17 +515,98 @@ void handleProgramPage(WebServer& server, ScheduleManager& scheduleManager) {
 }
 
 void handleSavePrograms(WebServer& server, ScheduleManager& scheduleManager) {
+    // The control task reads programs and zone settings; hold it off for the whole update.
+    // (Saving to flash stalls both cores anyway.)
+    ControlLock lock;
 
-    // Process each program
-    for (int p = 0; p < 3; p++) {
+    // Settings shared by all programs: any change re-lays every program
+    bool sharedChanged = false;
+
+    // Stacking options
+    if (server.hasArg("max_open_valves")) {
+        bool stack = server.hasArg("stack_programs");
+        sharedChanged |= stack != scheduleManager.stackPrograms;
+        scheduleManager.stackPrograms = stack;
+        int maxValves = server.arg("max_open_valves").toInt();
+        if (maxValves >= 1 && maxValves <= MAX_ZONES && maxValves != scheduleManager.maxOpenValves) {
+            // Only matters when stacking
+            sharedChanged |= scheduleManager.stackPrograms;
+            scheduleManager.maxOpenValves = maxValves;
+        }
+    }
+
+    // Water budget
+    if (server.hasArg("budget_percent")) {
+        // Any month counts: the schedule and the week's occupancy can span a month change
+        int budget = server.arg("budget_percent").toInt();
+        if (budget >= 0 && budget <= ScheduleManager::MAX_BUDGET_PERCENT && budget != scheduleManager.waterBudgetPercent) {
+            scheduleManager.waterBudgetPercent = budget;
+            sharedChanged = true;
+        }
+        for (int m = 0; m < 12; m++) {
+            String monthArg = "budget_month_" + String(m);
+            if (!server.hasArg(monthArg)) continue;
+            int percent = server.arg(monthArg).toInt();
+            if (percent >= 0 && percent <= ScheduleManager::MAX_BUDGET_PERCENT && percent != scheduleManager.monthlyBudgetPercent[m]) {
+                scheduleManager.monthlyBudgetPercent[m] = percent;
+                sharedChanged = true;
+            }
+        }
+        struct tm budgetNow;
+        WallClock::localNow(budgetNow);
+        scheduleManager.updateWaterBudget(budgetNow.tm_mon);
+    }
+
+    // Cycle-and-soak and flow settings per zone
+    if (server.hasArg("supply_capacity")) {
+        int supply = server.arg("supply_capacity").toInt();
+        supply = supply > 0 && supply <= 10000 ? supply : 0;
+        sharedChanged |= supply != scheduleManager.supplyCapacity;
+        scheduleManager.supplyCapacity = supply;
+    }
+    for (int z = 0; z < scheduleManager.count; z++) {
+        Sprinkler& sprinkler = scheduleManager.sprinklers[z];
+        String cycleArg = "zone_" + String(z) + "_cycle";
+        String soakArg = "zone_" + String(z) + "_soak";
+        String flowArg = "zone_" + String(z) + "_flow";
+        if (server.hasArg(flowArg)) {
+            int flow = server.arg(flowArg).toInt();
+            flow = flow > 0 && flow <= 10000 ? flow : 0;
+            sharedChanged |= flow != sprinkler.flowRate;
+            sprinkler.flowRate = flow;
+        }
+        if (server.hasArg(cycleArg)) {
+            int cycle = server.arg(cycleArg).toInt();
+            cycle = cycle > 0 && cycle <= 240 ? cycle : 0;
+            sharedChanged |= cycle != sprinkler.maxCycleMinutes;
+            sprinkler.maxCycleMinutes = cycle;
+        }
+        if (server.hasArg(soakArg)) {
+            int soak = server.arg(soakArg).toInt();
+            soak = soak > 0 && soak <= 240 ? soak : 0;
+            sharedChanged |= soak != sprinkler.minSoakMinutes;
+            sprinkler.minSoakMinutes = soak;
+        }
+    }
+
+    // Process each program, noting which ones changed and the zones they touch
+    uint32_t changedPrograms = 0;
+    uint32_t affectedZones = 0;
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
         Program& prog = scheduleManager.programs[p];
+        Program before = prog;
         
         // Enable/disable
         prog.enabled = server.hasArg("prog_" + String(p) + "_enabled");
         
-        // Start time
-        if (server.hasArg("prog_" + String(p) + "_start")) {
-            prog.startTime = server.arg("prog_" + String(p) + "_start");
+        // Start times: keep the valid ones, packed to the front
+        if (server.hasArg("prog_" + String(p) + "_start_0")) {
+            int numStarts = 0;
+            for (int k = 0; k < MAX_START_TIMES; k++) {
+                int minute = parseMinuteOfDay(server.arg("prog_" + String(p) + "_start_" + String(k)));
+                if (minute >= 0) prog.startTimes[numStarts++] = minute;
+            }
+            for (int k = numStarts; k < MAX_START_TIMES; k++) prog.startTimes[k] = NO_START_TIME;
         }
         
         // Days of week
@@ -417,6 +616,17 @@ void handleSavePrograms(WebServer& server, ScheduleManager& scheduleManager) {
                 prog.daysOfWeek[d] = (server.arg(dayArg) == "1");
             }
         }
+
+        // Recurrence
+        String recurArg = "prog_" + String(p) + "_recur";
+        if (server.hasArg(recurArg)) {
+            int recurrence = server.arg(recurArg).toInt();
+            prog.recurrence = recurrence >= 0 && recurrence < RECUR_TYPE_COUNT ? recurrence : RECUR_WEEKDAYS;
+            int every = server.arg("prog_" + String(p) + "_every").toInt();
+            if (every >= 1 && every <= 30) prog.intervalDays = every;
+            int32_t anchor;
+            if (parseEpochDay(server.arg("prog_" + String(p) + "_anchor"), anchor)) prog.intervalAnchorDay = anchor;
+        }
         
         // Zone durations
         for (int z = 0; z < scheduleManager.count; z++) {
@@ -425,28 +635,34 @@ void handleSavePrograms(WebServer& server, ScheduleManager& scheduleManager) {
                 prog.durations[z] = server.arg(durArg).toInt();
             }
         }
+
+        if (!programsEqual(before, prog)) {
+            changedPrograms |= 1UL << p;
+            affectedZones |= scheduleManager.programZoneMask(p);
+            for (int z = 0; z < scheduleManager.count; z++) {
+                if (before.durations[z] > 0) affectedZones |= 1UL << z;
+            }
+        }
     }
     
-    // Save programs to persistent storage
-    scheduleManager.savePrograms();
-    // Calculate today's schedules
-    time_t now;
-    time(&now);
-    struct tm* timeinfo = localtime(&now);
-    int today = timeinfo->tm_wday - 1;  // Convert to our 0=Monday format
-    if (today < 0) today = 6;  // Handle Sunday
-    scheduleManager.calculateZoneSchedules(today);
-    // Immediately update all sprinkler states after saving programs
-    time_t now2;
-    struct tm* timeinfo2;
-    ::time(&now2);
-    timeinfo2 = ::localtime(&now2);
-    int today2 = timeinfo2->tm_wday == 0 ? 6 : timeinfo2->tm_wday - 1;
-    int hour2 = timeinfo2->tm_hour;
-    int minute2 = timeinfo2->tm_min;
-    for (int i = 0; i < scheduleManager.count; i++) {
-        bool shouldBeOn = scheduleManager.checkSprinklerSchedule(i, today2, hour2, minute2);
-        scheduleManager.sprinklers[i].setState(shouldBeOn);
+    if (sharedChanged) {
+        changedPrograms = ScheduleManager::ALL_PROGRAMS;
+        affectedZones = ScheduleManager::ALL_ZONES;
+    }
+    if (changedPrograms != 0) {
+        // Save programs to persistent storage, then recompute only what changed
+        scheduleManager.savePrograms();
+        if (sharedChanged) {
+            struct tm timeinfo;
+            WallClock::localNow(timeinfo);
+            int today = timeinfo.tm_wday - 1;  // Convert to our 0=Monday format
+            if (today < 0) today = 6;  // Handle Sunday
+            scheduleManager.rebuildOccupancyIndex();
+            scheduleManager.calculateZoneSchedules(today);
+        } else {
+            scheduleManager.recalculatePrograms(changedPrograms, affectedZones);
+        }
+        // Publishing the new table requests a schedule pass, which switches the affected zones
     }
     // Redirect back to program page
     server.sendHeader("Location", "/programs", true);
@@ -1,67 +1,36 @@
 #include "schedule.h"
 #include <Arduino.h>
+#include "monotonic_clock.h"
 
 // Sequential Quick Run implementation for ScheduleManager
 // Runs through all enabled zones, one at a time, for the specified duration
 
-// Updated: Only run zones that are enabled and have nonzero duration for the selected program
-void ScheduleManager::startQuickRun(int durationSeconds, int programIndex) {
+// Only run zones that are enabled and have nonzero duration for the selected program
+void ScheduleManager::startQuickRun(uint32_t durationSeconds, int programIndex) {
     stopQuickRun(); // Ensure any previous run is cleared
-    quickRunDurationPerZone = durationSeconds * 1000;
-    quickRunNumZones = 0;
-    quickRunZoneIndex = 0;
-    quickRunCurrentZone = -1;
-    // Build list of enabled zones with nonzero duration for the selected program
+    if (durationSeconds == 0) return;
+    uint64_t perZoneMs = (uint64_t)durationSeconds * 1000;
+    RunSegment segments[MAX_ZONES];
+    int numZones = 0;
+    // One segment per enabled zone with nonzero duration, back to back
     for (int i = 0; i < count; ++i) {
         if (!sprinklers[i].disabled && programs[programIndex].durations[i] > 0) {
-            quickRunPendingZones[quickRunNumZones++] = i;
+            uint64_t endMs = (numZones + 1) * perZoneMs;
+            if (endMs > UINT32_MAX) return; // Longer than segment times can express (49 days)
+            segments[numZones].startMs = (uint32_t)(endMs - perZoneMs);
+            segments[numZones].endMs = (uint32_t)endMs;
+            segments[numZones].zone = i;
+            numZones++;
         }
     }
-    if (quickRunNumZones == 0) {
-        quickRunActive = false;
-        return;
-    }
-    quickRunActive = true;
-    quickRunZoneIndex = 0;
-    quickRunCurrentZone = quickRunPendingZones[quickRunZoneIndex];
-    quickRunStartTime = millis();
-    // Relay ON/OFF will be handled centrally in the main loop
+    // Relay ON/OFF is handled centrally by the control task
+    runs.startTimed(RunSource::QuickRun, programIndex, segments, numZones, MonotonicClock::nowMs());
 }
 
 void ScheduleManager::stopQuickRun() {
-    // Relay OFF will be handled centrally in the main loop
-    quickRunActive = false;
-    quickRunCurrentZone = -1;
-    quickRunZoneIndex = 0;
-    quickRunNumZones = 0;
-}
-
-void ScheduleManager::updateQuickRun() {
-    if (!quickRunActive) {
-        return;
-    }
-    unsigned long now = millis();
-    if (quickRunCurrentZone < 0 || quickRunZoneIndex >= quickRunNumZones) {
-        stopQuickRun();
-        return;
-    }
-    if (now - quickRunStartTime >= (unsigned long)quickRunDurationPerZone) {
-        // Time to move to next zone
-        quickRunZoneIndex++;
-        if (quickRunZoneIndex < quickRunNumZones) {
-            quickRunCurrentZone = quickRunPendingZones[quickRunZoneIndex];
-            quickRunStartTime = millis(); // Use fresh millis for next zone
-            // Set correct duration for this zone from the active program
-            if (currentRunNowProgramIndex >= 0 && currentRunNowProgramIndex < 3) {
-                quickRunDurationPerZone = programs[currentRunNowProgramIndex].durations[quickRunCurrentZone] * 60 * 1000;
-            }
-        } else {
-            stopQuickRun();
-        }
-    }
+    runs.stop(RunSource::QuickRun);
 }
 
-
 bool ScheduleManager::isQuickRunActive() const {
-    return quickRunActive;
+    return runs.isActive(RunSource::QuickRun);
 }
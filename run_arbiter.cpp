@@ -0,0 +1,125 @@
+/**
+ * @file run_arbiter.cpp
+ * @brief Priority arbitration between schedule, manual, Quick Run and Run Program Now.
+ */
+
+#include "run_arbiter.h"
+
+// Indexed by RunSource
+const RunPolicy RunArbiter::POLICIES[(int)RunSource::COUNT] = {
+    {true, Preemption::Pause},    // RunProgramNow (never preempted)
+    {true, Preemption::Pause},    // QuickRun: resumes after a Run Program Now
+    {false, Preemption::Ignore},  // Manual: hand-set zones come back afterwards
+    {false, Preemption::Ignore},  // Schedule: follows the wall clock
+};
+
+bool RunArbiter::startTimed(RunSource source, int program, const RunSegment* segments, int count, uint64_t nowMs) {
+    Slot& s = slot(source);
+    s.active = false;
+    if (count > MAX_SEGMENTS) count = MAX_SEGMENTS;
+    uint32_t totalMs = 0;
+    for (int i = 0; i < count; i++) {
+        s.segments[i] = segments[i];
+        if (segments[i].endMs > totalMs) totalMs = segments[i].endMs;
+    }
+    if (totalMs == 0) return false;
+    s.numSegments = count;
+    s.totalMs = totalMs;
+    s.heldMask = 0;
+    s.program = program;
+    s.startMs = nowMs;
+    s.paused = false;
+    s.active = true;
+    return true;
+}
+
+void RunArbiter::hold(RunSource source, uint32_t zoneMask, int program) {
+    Slot& s = slot(source);
+    s.heldMask = zoneMask;
+    s.program = program;
+    s.numSegments = 0;
+    s.totalMs = 0;
+    s.paused = false;
+    s.active = true;
+}
+
+void RunArbiter::stop(RunSource source) {
+    slot(source).active = false;
+}
+
+uint32_t RunArbiter::elapsedMs(RunSource source, uint64_t nowMs) const {
+    const Slot& s = slot(source);
+    uint64_t elapsed = (s.paused ? s.pausedAtMs : nowMs) - s.startMs;
+    return elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+}
+
+RunSource RunArbiter::advance(uint64_t nowMs) {
+    _owner = RunSource::COUNT;
+    for (int i = 0; i < (int)RunSource::COUNT; i++) {
+        RunSource source = (RunSource)i;
+        Slot& s = _slots[i];
+        if (!s.active) continue;
+        if (POLICIES[i].timed && elapsedMs(source, nowMs) >= s.totalMs) {
+            s.active = false;
+            continue;
+        }
+        if (_owner == RunSource::COUNT) {
+            if (s.paused) {
+                s.startMs += nowMs - s.pausedAtMs;
+                s.paused = false;
+            }
+            _owner = source;
+            continue;
+        }
+        switch (POLICIES[i].preempted) {
+        case Preemption::Pause:
+            if (!s.paused) {
+                s.paused = true;
+                s.pausedAtMs = nowMs;
+            }
+            break;
+        case Preemption::Cancel:
+            s.active = false;
+            break;
+        case Preemption::Ignore:
+            break;
+        }
+    }
+    return _owner;
+}
+
+uint32_t RunArbiter::zoneMask(uint64_t nowMs) const {
+    if (_owner == RunSource::COUNT) return 0;
+    const Slot& s = slot(_owner);
+    if (!POLICIES[(int)_owner].timed) return s.heldMask;
+    uint32_t elapsed = elapsedMs(_owner, nowMs);
+    uint32_t mask = 0;
+    for (int i = 0; i < s.numSegments; i++) {
+        if (elapsed >= s.segments[i].startMs && elapsed < s.segments[i].endMs) mask |= 1UL << s.segments[i].zone;
+    }
+    return mask;
+}
+
+bool RunArbiter::nextTransition(uint64_t nowMs, uint64_t& atMs) const {
+    if (_owner == RunSource::COUNT || !POLICIES[(int)_owner].timed) return false;
+    const Slot& s = slot(_owner);
+    uint32_t elapsed = elapsedMs(_owner, nowMs);
+    // Earliest segment start or end still ahead (the run's own end at the latest)
+    uint32_t next = s.totalMs;
+    for (int i = 0; i < s.numSegments; i++) {
+        if (s.segments[i].startMs > elapsed && s.segments[i].startMs < next) next = s.segments[i].startMs;
+        if (s.segments[i].endMs > elapsed && s.segments[i].endMs < next) next = s.segments[i].endMs;
+    }
+    atMs = s.startMs + next;
+    return true;
+}
+
+int RunArbiter::currentSegment(RunSource source, uint64_t nowMs) const {
+    const Slot& s = slot(source);
+    if (!s.active) return -1;
+    uint32_t elapsed = elapsedMs(source, nowMs);
+    for (int i = 0; i < s.numSegments; i++) {
+        if (elapsed >= s.segments[i].startMs && elapsed < s.segments[i].endMs) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,94 @@
+#ifndef RUN_ARBITER_H
+#define RUN_ARBITER_H
+
+#include <stdint.h>
+#include "schedule_limits.h"
+
+// Who may drive the zone relays, highest priority first
+enum class RunSource : uint8_t {
+    RunProgramNow,  // Timed: one program laid out from when it was started
+    QuickRun,       // Timed: each zone in turn for a fixed time
+    Manual,         // Held: zones toggled by hand in manual mode
+    Schedule,       // Held: zones the calculated schedule has on right now
+    COUNT
+};
+
+// What a run does while a higher-priority source is in control
+enum class Preemption : uint8_t {
+    Pause,   // Clock stops; continues where it left off once back in control
+    Cancel,  // Ends
+    Ignore   // Keeps going in the background (held zone masks, wall-clock runs)
+};
+
+struct RunPolicy {
+    bool timed;              // Ends by itself after its segments (otherwise held until stopped)
+    Preemption preempted;
+};
+
+// One zone opening of a timed run, relative to the run's start
+struct RunSegment {
+    uint32_t startMs;
+    uint32_t endMs;
+    uint8_t zone;
+};
+
+/**
+ * @brief Decides which zones are open from the active runs, one source at a time.
+ *
+ * Each RunSource has one slot. Timed sources hold a list of RunSegments and end
+ * by themselves; held sources keep a zone mask until stopped. The highest
+ * priority active source drives every relay, and what happens to a run it
+ * preempts is set by that source's RunPolicy. Adding a run mode means a new
+ * RunSource and policy row, not another branch in the control pass.
+ */
+class RunArbiter {
+public:
+    static const int MAX_SEGMENTS = MAX_ZONES * MAX_CYCLES_PER_ZONE;
+    static const RunPolicy POLICIES[(int)RunSource::COUNT];
+
+    // Start a timed run, replacing the source's previous one; false if it would not open any zone
+    bool startTimed(RunSource source, int program, const RunSegment* segments, int count, uint64_t nowMs);
+    // Start a held run, or change the zones it keeps open
+    void hold(RunSource source, uint32_t zoneMask, int program = -1);
+    void stop(RunSource source);
+
+    // End finished runs and apply preemption; returns the source in control (COUNT if none)
+    RunSource advance(uint64_t nowMs);
+    // Zones the source in control wants open (as of the last advance())
+    uint32_t zoneMask(uint64_t nowMs) const;
+    // MonotonicClock time of the next change the source in control makes; false if it makes none by itself
+    bool nextTransition(uint64_t nowMs, uint64_t& atMs) const;
+
+    RunSource owner() const { return _owner; }
+    bool isActive(RunSource source) const { return slot(source).active; }
+    bool isPaused(RunSource source) const { return slot(source).active && slot(source).paused; }
+    int program(RunSource source) const { return slot(source).active ? slot(source).program : -1; }
+    uint32_t heldZones(RunSource source) const { return slot(source).active ? slot(source).heldMask : 0; }
+    // Run time so far, not counting time paused (capped at UINT32_MAX)
+    uint32_t elapsedMs(RunSource source, uint64_t nowMs) const;
+    // Segments of an active timed run (0 when inactive)
+    int segmentCount(RunSource source) const { return slot(source).active ? slot(source).numSegments : 0; }
+    const RunSegment& segment(RunSource source, int index) const { return slot(source).segments[index]; }
+    // Segment open right now, or -1
+    int currentSegment(RunSource source, uint64_t nowMs) const;
+
+private:
+    struct Slot {
+        bool active = false;
+        bool paused = false;
+        int8_t program = -1;
+        uint64_t startMs = 0;          // MonotonicClock time at start, moved forward by time spent paused
+        uint64_t pausedAtMs = 0;
+        uint32_t totalMs = 0;          // End of the last segment
+        uint32_t heldMask = 0;         // Held runs: zones kept open
+        int numSegments = 0;
+        RunSegment segments[MAX_SEGMENTS];
+    };
+    Slot& slot(RunSource source) { return _slots[(int)source]; }
+    const Slot& slot(RunSource source) const { return _slots[(int)source]; }
+
+    Slot _slots[(int)RunSource::COUNT];
+    RunSource _owner = RunSource::COUNT;
+};
+
+#endif // RUN_ARBITER_H
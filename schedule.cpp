@@ -9,97 +9,212 @@
 
 #include "schedule.h"
 #include "config.h"
+#include "monotonic_clock.h"
+#include "wall_clock.h"
 #include "sprinkler_controller.h"
 
-// Copy configuration from one program to another and persist
-void ScheduleManager::copyProgram(int targetIndex, int sourceIndex) {
-    if (targetIndex == sourceIndex) return;
-    programs[targetIndex] = programs[sourceIndex];
-    savePrograms(); // Persist the change
+// JSON capacity for NUM_PROGRAMS programs of MAX_ZONES durations, plus start-time strings
+#define PROGRAMS_JSON_CAPACITY (JSON_OBJECT_SIZE(10) + JSON_ARRAY_SIZE(12) + JSON_ARRAY_SIZE(NUM_PROGRAMS) + \
+    NUM_PROGRAMS * (JSON_OBJECT_SIZE(7) + JSON_ARRAY_SIZE(MAX_START_TIMES) + JSON_ARRAY_SIZE(MAX_ZONES) + \
+    JSON_ARRAY_SIZE(7) + MAX_START_TIMES * 8) + 3 * JSON_ARRAY_SIZE(MAX_ZONES) + 256)
+
+// Parse "HH:mm" into minutes since midnight, or -1 if invalid
+int parseMinuteOfDay(const String& hhmm) {
+    if (hhmm.length() != 5 || hhmm[2] != ':') return -1;
+    const char* c = hhmm.c_str();
+    for (int i = 0; i < 5; i++) {
+        if (i != 2 && (c[i] < '0' || c[i] > '9')) return -1;
+    }
+    int hours = (c[0] - '0') * 10 + (c[1] - '0');
+    int minutes = (c[3] - '0') * 10 + (c[4] - '0');
+    if (hours > 23 || minutes > 59) return -1;
+    return hours * 60 + minutes;
 }
 
-// Implements "Run Program Now" for a program
-void ScheduleManager::startRunProgramNow(int programIndex) {
-    // Set the program's startTime to the current local time (HH:mm)
-    time_t now;
-    struct tm* timeinfo;
-    time(&now);
-    timeinfo = localtime(&now);
+// Format minutes since midnight as "HH:mm"
+String formatMinuteOfDay(int minuteOfDay) {
+    minuteOfDay %= 1440;
+    if (minuteOfDay < 0) minuteOfDay += 1440;
     char buf[6];
-    snprintf(buf, sizeof(buf), "%02d:%02d", timeinfo->tm_hour, timeinfo->tm_min);
-    programs[programIndex].startTime = String(buf);
+    snprintf(buf, sizeof(buf), "%02d:%02d", minuteOfDay / 60, minuteOfDay % 60);
+    return String(buf);
+}
 
-    // Force recalculation of end times for today using current local time
-    time_t nowCalc;
-    struct tm* timeinfoCalc;
-    time(&nowCalc);
-    timeinfoCalc = localtime(&nowCalc);
-    int today = (timeinfoCalc->tm_wday + 6) % 7; // 0=Monday, 1=Tuesday, ...
-    calculateZoneSchedules(today);
+// Parse "YYYY-MM-DD" into an epoch day
+bool parseEpochDay(const String& date, int32_t& epochDay) {
+    if (date.length() != 10 || date[4] != '-' || date[7] != '-') return false;
+    int year = date.substring(0, 4).toInt();
+    int month = date.substring(5, 7).toInt();
+    int day = date.substring(8, 10).toInt();
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) return false;
+    epochDay = epochDayFromCivil(year, month, day);
+    return true;
+}
+
+// Format an epoch day as "YYYY-MM-DD"
+String formatEpochDay(int32_t epochDay) {
+    int year, month, day;
+    civilFromEpochDay(epochDay, year, month, day);
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d", year, month, day);
+    return String(buf);
+}
 
-    // Reset all Run Program Now state
-    currentRunNowProgramIndex = programIndex;
-    runProgramNowNumZones = 0;
-    runProgramNowZoneIndex = 0;
-    runProgramNowCurrentZone = -1;
-    runProgramNowActive = false;
-
-    // Build list of enabled zones with nonzero duration for the selected program
-    for (int i = 0; i < count; ++i) {
-        if (!sprinklers[i].disabled && programs[programIndex].durations[i] > 0) {
-            runProgramNowPendingZones[runProgramNowNumZones++] = i;
+/**
+ * @brief Tests whether a program's recurrence includes a date.
+ *
+ * Constant time for every recurrence type: a weekday lookup, one modulo for
+ * intervals, or one date conversion for odd/even days.
+ * @param program Program to test (enabled is not checked)
+ * @param epochDay Date as days since 1970-01-01
+ */
+bool programRunsOnDay(const Program& program, int32_t epochDay) {
+    switch (program.recurrence) {
+        case RECUR_INTERVAL: {
+            if (program.intervalDays == 0) return false;
+            int32_t offset = (epochDay - program.intervalAnchorDay) % program.intervalDays;
+            return offset == 0;
+        }
+        case RECUR_ODD_DAYS:
+        case RECUR_EVEN_DAYS: {
+            int year, month, day;
+            civilFromEpochDay(epochDay, year, month, day);
+            return (day % 2 == 1) == (program.recurrence == RECUR_ODD_DAYS);
         }
+        default:
+            return program.daysOfWeek[weekdayFromEpochDay(epochDay)];
     }
-    if (runProgramNowNumZones == 0) {
-        runProgramNowActive = false;
-        return;
+}
+
+/**
+ * @brief Lists a program's next run days.
+ *
+ * Computes the dates directly instead of testing every day: weekly patterns
+ * repeat the week's offsets, intervals are an arithmetic sequence and odd/even
+ * days step by two within each month.
+ * @param program Program to forecast (enabled is not checked)
+ * @param fromDay First epoch day to consider
+ * @param out Destination for up to maxDays epoch days, ascending
+ * @param maxDays Capacity of out
+ * @return Number of days written
+ */
+int forecastRunDays(const Program& program, int32_t fromDay, int32_t* out, int maxDays) {
+    int found = 0;
+    switch (program.recurrence) {
+        case RECUR_INTERVAL: {
+            if (program.intervalDays == 0) return 0;
+            int32_t offset = (program.intervalAnchorDay - fromDay) % program.intervalDays;
+            if (offset < 0) offset += program.intervalDays;
+            for (; found < maxDays; found++) out[found] = fromDay + offset + (int32_t)found * program.intervalDays;
+            break;
+        }
+        case RECUR_ODD_DAYS:
+        case RECUR_EVEN_DAYS: {
+            int parity = program.recurrence == RECUR_ODD_DAYS ? 1 : 0;
+            int year, month, day;
+            civilFromEpochDay(fromDay, year, month, day);
+            int32_t monthStart = fromDay - (day - 1);
+            while (found < maxDays) {
+                if (day % 2 != parity) day++;
+                int length = daysInMonth(year, month);
+                for (; day <= length && found < maxDays; day += 2) out[found++] = monthStart + day - 1;
+                monthStart += length;
+                if (++month > 12) {
+                    month = 1;
+                    year++;
+                }
+                day = 1;
+            }
+            break;
+        }
+        default: {
+            // Offsets (0-6) of the run days in the week starting at fromDay
+            int offsets[7];
+            int perWeek = 0;
+            int firstWeekday = weekdayFromEpochDay(fromDay);
+            for (int k = 0; k < 7; k++) {
+                if (program.daysOfWeek[(firstWeekday + k) % 7]) offsets[perWeek++] = k;
+            }
+            if (perWeek == 0) return 0;
+            for (; found < maxDays; found++) out[found] = fromDay + 7 * (found / perWeek) + offsets[found % perWeek];
+            break;
+        }
     }
+    return found;
+}
 
-    // Set up to run the first valid zone
-    runProgramNowActive = true;
-    runProgramNowZoneIndex = 0;
-    if (runProgramNowZoneIndex >= 0 && runProgramNowZoneIndex < runProgramNowNumZones) {
-        runProgramNowCurrentZone = runProgramNowPendingZones[runProgramNowZoneIndex];
-    } else {
-        runProgramNowActive = false;
-        return;
+bool programsEqual(const Program& a, const Program& b) {
+    if (a.enabled != b.enabled || a.recurrence != b.recurrence ||
+        a.intervalDays != b.intervalDays || a.intervalAnchorDay != b.intervalAnchorDay) return false;
+    for (int k = 0; k < MAX_START_TIMES; k++) {
+        if (a.startTimes[k] != b.startTimes[k]) return false;
+    }
+    for (int z = 0; z < MAX_ZONES; z++) {
+        if (a.durations[z] != b.durations[z]) return false;
+    }
+    for (int d = 0; d < 7; d++) {
+        if (a.daysOfWeek[d] != b.daysOfWeek[d]) return false;
     }
-    runProgramNowStartTime = millis();
-    runProgramNowDurationPerZone = programs[programIndex].durations[runProgramNowCurrentZone] * 60 * 1000; // ms
+    return true;
+}
 
-    // Mark state for main loop to handle relay control
+// Zones with a run time in the program (bit z = zone z)
+uint32_t ScheduleManager::programZoneMask(int programIndex) const {
+    uint32_t mask = 0;
+    for (int z = 0; z < count; z++) {
+        if (programs[programIndex].durations[z] > 0) mask |= 1UL << z;
+    }
+    return mask;
+}
+
+// Copy configuration from one program to another and persist
+void ScheduleManager::copyProgram(int targetIndex, int sourceIndex) {
+    if (targetIndex == sourceIndex) return;
+    uint32_t zones = programZoneMask(targetIndex) | programZoneMask(sourceIndex);
+    programs[targetIndex] = programs[sourceIndex];
+    savePrograms(); // Persist the change
+    recalculatePrograms(1UL << targetIndex, zones);
+}
+
+// Implements "Run Program Now" for a program; false (program unchanged) if it cannot run
+bool ScheduleManager::startRunProgramNow(int programIndex) {
+    // Lay out the enabled zones with the same engine as the schedule
+    // (cycle-and-soak and flow budget apply), relative to now
+    static ZoneRun layout[MAX_RUNS_PER_START];       // Static: up to several KB at the largest build sizes
+    static RunSegment segments[MAX_RUNS_PER_START];
+    int numRuns = layoutProgramStart(programIndex, 0, 0, layout, true);
+    for (int r = 0; r < numRuns; r++) {
+        uint64_t startMs = (uint64_t)layout[r].startMinute * 60 * 1000;
+        uint64_t endMs = startMs + (uint64_t)layout[r].duration * 60 * 1000;
+        if (endMs > UINT32_MAX) return false; // Longer than segment times can express (49 days)
+        segments[r].startMs = (uint32_t)startMs;
+        segments[r].endMs = (uint32_t)endMs;
+        segments[r].zone = layout[r].zone;
+    }
+    if (!runs.startTimed(RunSource::RunProgramNow, programIndex, segments, numRuns, MonotonicClock::nowMs())) {
+        return false; // No zone to run
+    }
+
+    // The run is on: move the program's first start time to the current local time
+    struct tm timeinfo;
+    WallClock::localNow(timeinfo);
+    programs[programIndex].startTimes[0] = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+
+    // Force recalculation of end times for today using current local time
+    int today = (timeinfo.tm_wday + 6) % 7; // 0=Monday, 1=Tuesday, ...
+    calculateZoneSchedules(today);
+    rebuildOccupancyIndex();
     savePrograms();
+    return true;
 }
 
 // Stop Run Program Now for all programs
 void ScheduleManager::stopRunProgramNow() {
-    runProgramNowActive = false;
-    currentRunNowProgramIndex = -1;
+    runs.stop(RunSource::RunProgramNow);
 }
 
-// Update Run Program Now sequencing (completely independent from Quick Run)
-void ScheduleManager::updateRunProgramNow() {
-    if (!runProgramNowActive) return;
-    unsigned long now = millis();
-    if (runProgramNowCurrentZone < 0 || runProgramNowZoneIndex >= runProgramNowNumZones) {
-        runProgramNowActive = false;
-        currentRunNowProgramIndex = -1;
-        return;
-    }
-    if (now - runProgramNowStartTime >= runProgramNowDurationPerZone) {
-        runProgramNowZoneIndex++;
-        if (runProgramNowZoneIndex < runProgramNowNumZones) {
-            runProgramNowCurrentZone = runProgramNowPendingZones[runProgramNowZoneIndex];
-            runProgramNowStartTime = millis();
-            // Set correct duration for this zone from the active program
-            if (currentRunNowProgramIndex >= 0 && currentRunNowProgramIndex < 3) {
-                runProgramNowDurationPerZone = programs[currentRunNowProgramIndex].durations[runProgramNowCurrentZone] * 60 * 1000;
-            }
-        } else {
-            runProgramNowActive = false;
-            currentRunNowProgramIndex = -1;
-        }
-    }
+bool ScheduleManager::nextRunTransition(uint64_t& atMs) const {
+    return runs.nextTransition(MonotonicClock::nowMs(), atMs);
 }
 
 // Utility: Clear all schedule data from Preferences
@@ -108,7 +223,7 @@ void ScheduleManager::clearAllPreferences() {
     prefs.begin("sprinkler_sched", false);
     for (int i = 0; i < count; i++) {
         for (int d = 0; d < 7; d++) {
-            for (int p = 0; p < 3; p++) {
+            for (int p = 0; p < NUM_PROGRAMS; p++) {
                 String keyStart = String("sch_") + i + "_" + d + "_" + p + "_start";
                 String keyEnd = String("sch_") + i + "_" + d + "_" + p + "_end";
                 prefs.remove(keyStart.c_str());
@@ -121,12 +236,7 @@ void ScheduleManager::clearAllPreferences() {
 }
 
 // Sprinkler Constructor
-Sprinkler::Sprinkler() : state(false), disabled(false), zone(-1), _controller(nullptr) {
-    for (int p = 0; p < 3; p++) {
-        calculatedSchedules[p].startTime = "";
-        calculatedSchedules[p].endTime = "";
-        calculatedSchedules[p].programIndex = 0;
-    }
+Sprinkler::Sprinkler() : maxCycleMinutes(0), minSoakMinutes(0), flowRate(0), state(false), disabled(false), zone(-1), _controller(nullptr) {
 }
 
 void Sprinkler::init(int zoneIndex, SprinklerController* controller) {
@@ -157,11 +267,23 @@ void Sprinkler::setState(bool on) {
  * Handles zone state, schedule calculation, persistence, and Quick Run sequencing.
  */
 ScheduleManager::ScheduleManager(int num, SprinklerController* controller) : count(num), _controller(controller) {
+    if (count > MAX_ZONES) count = MAX_ZONES; // Programs only hold MAX_ZONES durations
     sprinklers = new Sprinkler[count];
+    _dayRuns = new ZoneRun[MAX_RUNS_PER_DAY];
+    _finalizeScratch = new ZoneInterval[ScheduleTable::CAPACITY];
+    for (int m = 0; m < 12; m++) monthlyBudgetPercent[m] = 100;
     // Initialize each sprinkler with its zone index and controller
     for (int i = 0; i < count; i++) {
         sprinklers[i].init(i, controller);
     }
+    occupancy.begin(count);
+}
+
+size_t ScheduleManager::footprintBytes(int num) {
+    if (num > MAX_ZONES) num = MAX_ZONES;
+    return sizeof(ScheduleManager) + num * sizeof(Sprinkler) + MAX_RUNS_PER_DAY * sizeof(ZoneRun) +
+           ScheduleTable::CAPACITY * sizeof(ZoneInterval) +
+           (size_t)num * OccupancyIndex::WORDS_PER_ZONE * sizeof(uint32_t);
 }
 
 /**
@@ -171,6 +293,8 @@ ScheduleManager::ScheduleManager(int num, SprinklerController* controller) : cou
  */
 ScheduleManager::~ScheduleManager() {
     delete[] sprinklers;
+    delete[] _dayRuns;
+    delete[] _finalizeScratch;
 }
 
 /**
@@ -180,150 +304,563 @@ ScheduleManager::~ScheduleManager() {
  */
 void ScheduleManager::initializePrograms() {
     // Clear all programs so the user can input their own from the web interface
-    for (int p = 0; p < 3; p++) {
-        programs[p].startTime = "";
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        for (int k = 0; k < MAX_START_TIMES; k++) {
+            programs[p].startTimes[k] = NO_START_TIME;
+        }
         programs[p].enabled = false;
-        for (int z = 0; z < 8; z++) {
+        for (int z = 0; z < MAX_ZONES; z++) {
             programs[p].durations[z] = 0;
         }
         for (int d = 0; d < 7; d++) {
             programs[p].daysOfWeek[d] = false;
         }
+        programs[p].recurrence = RECUR_WEEKDAYS;
+        programs[p].intervalDays = 1;
+        programs[p].intervalAnchorDay = 0;
     }
 
-    // Clear all calculated schedules in sprinklers
-    for (int s = 0; s < count; s++) {
-        for (int p = 0; p < 3; p++) {
-            sprinklers[s].calculatedSchedules[p].startTime = "";
-            sprinklers[s].calculatedSchedules[p].endTime = "";
-            sprinklers[s].calculatedSchedules[p].programIndex = 0;
-        }
+    // Clear the calculated schedule
+    ScheduleTable& empty = backSchedule();
+    empty.clear();
+    empty.finalize(_finalizeScratch);
+    _activeSchedule.store(&empty, std::memory_order_release);
+    _horizonBuilt = false;
+    _prepared = false;
+
+    rebuildOccupancyIndex();
+}
+
+// Scale minutes by a 16.16 fixed-point budget, rounding to the nearest minute
+static uint16_t scaleDuration(uint16_t minutes, uint32_t scaleQ16) {
+    uint64_t scaled = ((uint64_t)minutes * scaleQ16 + 0x8000) >> 16;
+    return scaled > 0xFFFF ? 0xFFFF : (uint16_t)scaled;
+}
+
+// Number of cycles a zone's duration is split into by its cycle-and-soak settings
+static int cycleCount(int duration, int maxCycleMinutes) {
+    if (duration <= 0) return 0;
+    if (maxCycleMinutes <= 0) return 1;
+    int cycles = (duration + maxCycleMinutes - 1) / maxCycleMinutes;
+    return cycles > MAX_CYCLES_PER_ZONE ? MAX_CYCLES_PER_ZONE : cycles;
+}
+
+/**
+ * @brief Lays out one start of a program, packing cycle-and-soak cycles and
+ * running zones in parallel within the flow budget.
+ *
+ * Durations are first scaled by scaleQ16, the seasonal water budget of the
+ * day being laid out. Zones whose
+ * duration exceeds their maxCycleMinutes are split into equal
+ * cycles (at most MAX_CYCLES_PER_ZONE) that must be minSoakMinutes apart.
+ * Whenever a zone finishes or comes out of its soak, free zones are started
+ * best first (most cycles left, then largest flow: a first-fit-decreasing
+ * bin packing) while their combined flowRate fits supplyCapacity. Without a
+ * supply capacity only one zone runs at a time, so other zones' cycles fill
+ * the soak gaps; without cycle-and-soak settings either, this is plain zone
+ * order, back to back.
+ * @param programIndex Program to lay out (0 = A)
+ * @param startMinute Start, minutes since midnight
+ * @param startIndex Which of the program's start times this is
+ * @param out Destination for up to MAX_RUNS_PER_START runs, in start order
+ * @param skipDisabled Leave out disabled zones (Run Program Now)
+ * @param scaleQ16 Water budget, 16.16 fixed point
+ * @return Number of runs written
+ */
+int ScheduleManager::layoutStart(int programIndex, int startMinute, int startIndex, ZoneRun* out,
+                                 bool skipDisabled, uint32_t scaleQ16) const {
+    const Program& program = programs[programIndex];
+    int cyclesLeft[MAX_ZONES];
+    int minutesLeft[MAX_ZONES];
+    int availableAt[MAX_ZONES];
+    int runningUntil[MAX_ZONES];
+    int flow[MAX_ZONES];
+    int pending = 0;
+    for (int z = 0; z < count; z++) {
+        bool skip = skipDisabled && sprinklers[z].disabled;
+        minutesLeft[z] = scaleDuration(program.durations[z], scaleQ16);
+        cyclesLeft[z] = skip ? 0 : cycleCount(minutesLeft[z], sprinklers[z].maxCycleMinutes);
+        availableAt[z] = startMinute;
+        runningUntil[z] = -1;
+        // Unknown flow takes the whole supply, so the zone runs alone
+        flow[z] = sprinklers[z].flowRate > 0 ? sprinklers[z].flowRate : supplyCapacity;
+        pending += cyclesLeft[z];
     }
 
-    
-    for (int i = 0; i < count; i++) {
+    int runs = 0;
+    int numRunning = 0;
+    int usedFlow = 0;
+    int currentMinute = startMinute;
+    while (pending > 0 && currentMinute < OccupancyIndex::MINUTES_PER_WEEK) { // Guard against absurd durations
+        for (int z = 0; z < count; z++) {
+            if (runningUntil[z] >= 0 && runningUntil[z] <= currentMinute) {
+                runningUntil[z] = -1;
+                usedFlow -= flow[z];
+                numRunning--;
+            }
+        }
 
-        
-        for (int d = 0; d < 7; d++) {
-            for (int p = 0; p < 3; p++) {
-                sprinklers[i].calculatedSchedules[p].startTime = "";
-                sprinklers[i].calculatedSchedules[p].endTime = "";
-                sprinklers[i].calculatedSchedules[p].programIndex = 0;
+        // Start every free zone that fits, best first
+        for (;;) {
+            int next = -1;
+            for (int z = 0; z < count; z++) {
+                if (cyclesLeft[z] == 0 || runningUntil[z] >= 0 || availableAt[z] > currentMinute) continue;
+                bool fits = numRunning == 0 || (supplyCapacity > 0 && usedFlow + flow[z] <= supplyCapacity);
+                if (!fits) continue;
+                if (next < 0 || cyclesLeft[z] > cyclesLeft[next] ||
+                    (supplyCapacity > 0 && cyclesLeft[z] == cyclesLeft[next] && flow[z] > flow[next])) {
+                    next = z;
+                }
             }
+            if (next < 0) break;
+            int duration = (minutesLeft[next] + cyclesLeft[next] - 1) / cyclesLeft[next];
+            out[runs].startMinute = currentMinute;
+            out[runs].duration = duration;
+            out[runs].zone = next;
+            out[runs].programIndex = programIndex;
+            out[runs].startIndex = startIndex;
+            runs++;
+            minutesLeft[next] -= duration;
+            cyclesLeft[next]--;
+            pending--;
+            runningUntil[next] = currentMinute + duration;
+            availableAt[next] = runningUntil[next] + sprinklers[next].minSoakMinutes;
+            usedFlow += flow[next];
+            numRunning++;
         }
+
+        // Advance to the next event: a zone finishing or coming out of its soak
+        int nextEvent = -1;
+        for (int z = 0; z < count; z++) {
+            int event = -1;
+            if (runningUntil[z] >= 0) event = runningUntil[z];
+            else if (cyclesLeft[z] > 0 && availableAt[z] > currentMinute) event = availableAt[z];
+            if (event >= 0 && (nextEvent < 0 || event < nextEvent)) nextEvent = event;
+        }
+        if (nextEvent < 0) break;
+        currentMinute = nextEvent;
     }
-    
+    return runs;
+}
 
+int ScheduleManager::layoutProgramStart(int programIndex, int startMinute, int startIndex, ZoneRun* out,
+                                        bool skipDisabled) const {
+    return layoutStart(programIndex, startMinute, startIndex, out, skipDisabled, _budgetScaleQ16);
 }
 
 /**
- * @brief Calculates schedules for all sprinklers on a given day.
+ * @brief Recomputes the current month's water budget scale.
  *
- * @param dayOfWeek Day of the week (0-6) to calculate schedules for.
+ * Called at day rollover (and when the budget settings change). The global and
+ * monthly percentages are folded into one 16.16 fixed-point factor so laying
+ * out a run costs one multiply and shift per zone, with no floating point.
+ * This scale is for runs started now (Run Program Now) and the program page;
+ * the schedule lays out each day with its own month's scale, so a month
+ * change does not touch runs laid out for the day before.
+ * @param month Month, 0 = January (struct tm::tm_mon)
+ * @return True if the scale changed
  */
-void ScheduleManager::calculateZoneSchedules(int dayOfWeek) {
+bool ScheduleManager::updateWaterBudget(int month) {
+    uint32_t scale = budgetScaleForMonth(month);
+    if (scale == _budgetScaleQ16) return false;
+    _budgetScaleQ16 = scale;
+    return true;
+}
+
+// Combined global and monthly budget for a month (0-11) in 16.16 fixed point
+uint32_t ScheduleManager::budgetScaleForMonth(int month) const {
+    if (month < 0 || month > 11) month = 0;
+    uint32_t global = waterBudgetPercent > MAX_BUDGET_PERCENT ? MAX_BUDGET_PERCENT : waterBudgetPercent;
+    uint32_t monthly = monthlyBudgetPercent[month] > MAX_BUDGET_PERCENT ? MAX_BUDGET_PERCENT : monthlyBudgetPercent[month];
+    // (global x monthly / 10000) in 16.16: x 65536 / 10000 reduces to x 4096 / 625,
+    // which keeps 300% x 300% within 32 bits
+    return (global * monthly * 4096UL + 312) / 625;
+}
+
+// Budget scale of the month an epoch day falls in
+uint32_t ScheduleManager::budgetScaleForDay(int32_t epochDay) const {
+    int year, month, day;
+    civilFromEpochDay(epochDay, year, month, day);
+    return budgetScaleForMonth(month - 1);
+}
+
+// Scale a duration by the water budget, rounding to the nearest minute
+uint16_t ScheduleManager::budgetedDuration(uint16_t minutes) const {
+    return scaleDuration(minutes, _budgetScaleQ16);
+}
+
+/**
+ * @brief Computes the watering window of one program start.
+ *
+ * @param programIndex Program to measure (0 = A)
+ * @param packedMinutes Window as laid out by layoutProgramStart()
+ * @param sequentialMinutes Window running each zone's cycles and soaks before the next zone
+ */
+void ScheduleManager::programWindowMinutes(int programIndex, int& packedMinutes, int& sequentialMinutes) const {
+    ZoneRun runs[MAX_RUNS_PER_START];
+    int numRuns = layoutProgramStart(programIndex, 0, 0, runs);
+    packedMinutes = 0;
+    for (int r = 0; r < numRuns; r++) {
+        int end = runs[r].startMinute + runs[r].duration;
+        if (end > packedMinutes) packedMinutes = end;
+    }
+    sequentialMinutes = 0;
+    for (int z = 0; z < count; z++) {
+        int minutes = budgetedDuration(programs[programIndex].durations[z]);
+        int cycles = cycleCount(minutes, sprinklers[z].maxCycleMinutes);
+        if (cycles == 0) continue;
+        sequentialMinutes += minutes + (cycles - 1) * sprinklers[z].minSoakMinutes;
+    }
+}
+
+/**
+ * @brief Lays out one program's zone runs for a given day.
+ *
+ * This is the single schedule engine used for every program: each of the
+ * program's start times is laid out by layoutStart() with the water budget
+ * of the day's month.
+ * @param programIndex Program to lay out (0 = A)
+ * @param epochDay Date (days since 1970-01-01); the program must be enabled and recur on it
+ * @param out Destination for up to MAX_RUNS_PER_PROGRAM runs
+ * @return Number of runs written (0 if the program does not run that day)
+ */
+int ScheduleManager::buildProgramRuns(int programIndex, int32_t epochDay, ZoneRun* out) const {
+    const Program& program = programs[programIndex];
+    if (!program.enabled || !programRunsOnDay(program, epochDay)) return 0;
+    int runs = 0;
+    uint32_t scaleQ16 = budgetScaleForDay(epochDay);
+    for (int k = 0; k < MAX_START_TIMES; k++) {
+        if (program.startTimes[k] >= 1440) continue; // Unused (NO_START_TIME) or invalid
+        runs += layoutStart(programIndex, program.startTimes[k], k, out + runs, false, scaleQ16);
+    }
+    return runs;
+}
 
-    // Clear all existing calculated schedules first
-    for (int s = 0; s < count; s++) {
-        for (int p = 0; p < 3; p++) {
-            sprinklers[s].calculatedSchedules[p].startTime = "";
-            sprinklers[s].calculatedSchedules[p].endTime = "";
-            sprinklers[s].calculatedSchedules[p].programIndex = 0;
+/**
+ * @brief Merges overlapping program runs into one queue (program stacking).
+ *
+ * Sweeps the program starts in time order. Each start's runs keep their
+ * order and are only ever pushed back by a growing shift, so cycle-and-soak
+ * gaps never shrink and runs that were sequential stay sequential. A run
+ * begins once the zone itself is free and one of the maxOpenValves valve
+ * slots is available. An earlier start therefore
+ * keeps its times and later overlapping starts are pushed back instead of
+ * opening extra valves. Runs that would not start
+ * before the end of the following day are dropped.
+ * @param runs Runs grouped by program and start, each group in time order
+ * @param numRuns Number of runs
+ * @param maxOpenValves Valves allowed open at once
+ * @return Number of runs kept (start times rewritten in place, dropped runs removed)
+ */
+static int stackRuns(ZoneRun* runs, int numRuns, int maxOpenValves) {
+    const int MAX_SEQUENCES = NUM_PROGRAMS * MAX_START_TIMES;
+    const int STACK_LIMIT = 2 * 1440;
+    int seqHead[MAX_SEQUENCES + 1];
+    int numSeq = 0;
+    for (int r = 0; r < numRuns; r++) {
+        if (r == 0 || runs[r].programIndex != runs[r - 1].programIndex ||
+            runs[r].startIndex != runs[r - 1].startIndex) {
+            seqHead[numSeq++] = r;
         }
     }
-    // --- Program A (index 0) ---
-    int p = 0;
+    seqHead[numSeq] = numRuns;
 
+    // Sweep order: by start time, then program (insertion sort of sequence indices)
+    uint8_t order[MAX_SEQUENCES];
+    for (int q = 0; q < numSeq; q++) {
+        int key = q;
+        int j = q - 1;
+        while (j >= 0 && runs[seqHead[order[j]]].startMinute > runs[seqHead[key]].startMinute) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = key;
+    }
 
-    
+    if (maxOpenValves < 1) maxOpenValves = 1;
+    if (maxOpenValves > MAX_ZONES) maxOpenValves = MAX_ZONES;
+    int slotFree[MAX_ZONES] = {0};
+    int zoneFree[MAX_ZONES] = {0};
 
-    if (programs[p].enabled && programs[p].daysOfWeek[dayOfWeek]) {
-        String currentTime = programs[p].startTime;
-        if (currentTime.length() == 5) {
-            for (int z = 0; z < count; z++) {
-                if (programs[p].durations[z] == 0) continue;
-            
-                sprinklers[z].calculatedSchedules[0].startTime = currentTime;
-                sprinklers[z].calculatedSchedules[0].programIndex = p;
-                int hours = currentTime.substring(0, 2).toInt();
-                int minutes = currentTime.substring(3, 5).toInt();
-                minutes += programs[p].durations[z];
-                while (minutes >= 60) {
-                    hours++;
-                    minutes -= 60;
+    for (int i = 0; i < numSeq; i++) {
+        int q = order[i];
+        int shift = 0;  // How far this start has been pushed back so far
+        for (int r = seqHead[q]; r < seqHead[q + 1]; r++) {
+            ZoneRun& run = runs[r];
+            int ready = run.startMinute + shift;
+            if (zoneFree[run.zone] > ready) ready = zoneFree[run.zone];
+            // Best fit: the slot freed most recently before ready, else the one freed first
+            int slot = -1;
+            for (int v = 0; v < maxOpenValves; v++) {
+                if (slotFree[v] <= ready && (slot < 0 || slotFree[v] > slotFree[slot])) slot = v;
+            }
+            if (slot < 0) {
+                slot = 0;
+                for (int v = 1; v < maxOpenValves; v++) {
+                    if (slotFree[v] < slotFree[slot]) slot = v;
                 }
-                if (hours >= 24) hours -= 24;
-                char endTime[6];
-                sprintf(endTime, "%02d:%02d", hours, minutes);
-                sprinklers[z].calculatedSchedules[0].endTime = String(endTime);
-            
-currentTime = String(endTime);
+                ready = slotFree[slot];
             }
+            if (ready >= STACK_LIMIT) {
+                // This run and the rest of its sequence would start even later: drop them
+                for (; r < seqHead[q + 1]; r++) runs[r].duration = 0;
+                break;
+            }
+            shift = ready - run.startMinute;
+            run.startMinute = ready;
+            slotFree[slot] = ready + run.duration;
+            zoneFree[run.zone] = ready + run.duration;
         }
     }
 
+    int kept = 0;
+    for (int r = 0; r < numRuns; r++) {
+        if (runs[r].duration > 0) runs[kept++] = runs[r];
+    }
+    return kept;
+}
 
-    // --- Program B (index 1) ---
-    p = 1;
+/**
+ * @brief Lays out every program's runs for a day.
+ *
+ * With stacking enabled the runs are merged into one queue limited to
+ * maxOpenValves open valves; otherwise programs run as configured and may overlap.
+ * @param epochDay Date (days since 1970-01-01)
+ * @param out Destination for up to MAX_RUNS_PER_DAY runs
+ * @param programMask Programs to lay out (bit p = program p); a partial mask skips stacking
+ * @return Number of runs written
+ */
+int ScheduleManager::buildDayRuns(int32_t epochDay, ZoneRun* out, uint32_t programMask) const {
+    int numRuns = 0;
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        if ((programMask >> p) & 1) numRuns += buildProgramRuns(p, epochDay, out + numRuns);
+    }
+    if (stackPrograms && programMask == ALL_PROGRAMS && numRuns > 0) numRuns = stackRuns(out, numRuns, maxOpenValves);
+    return numRuns;
+}
 
+// Add one day's runs of the programs in programMask to a horizon table, offset
+// minutes after the horizon start
+void ScheduleManager::appendHorizonDay(ScheduleTable& table, int32_t epochDay, int offset, uint32_t programMask) {
+    int numRuns = buildDayRuns(epochDay, _dayRuns, programMask);
+    for (int r = 0; r < numRuns; r++) {
+        const ZoneRun& run = _dayRuns[r];
+        int start = offset + run.startMinute;
+        table.add(run.zone, start, start + run.duration, run.programIndex, run.startIndex);
+    }
+}
 
-    
+// Build the horizon ending with today into table (never the active one). The day
+// after the active schedule reuses its runs as yesterday; anything else is laid
+// out from the programs.
+void ScheduleManager::buildHorizon(ScheduleTable& table, int32_t today) {
+    if (_horizonBuilt && today == _horizonDay + 1) {
+        table.rebaseFrom(activeSchedule(), HORIZON_TODAY);  // Today becomes yesterday
+    } else {
+        table.clear();
+        appendHorizonDay(table, today - 1, 0);
+    }
+    appendHorizonDay(table, today, HORIZON_TODAY);
+    table.finalize(_finalizeScratch);
+}
 
-    if (programs[p].enabled && programs[p].daysOfWeek[dayOfWeek]) {
-        String currentTime = programs[p].startTime;
-        if (currentTime.length() == 5) {
-            for (int z = 0; z < count; z++) {
-                if (programs[p].durations[z] == 0) continue;
-            
-                sprinklers[z].calculatedSchedules[1].startTime = currentTime;
-                sprinklers[z].calculatedSchedules[1].programIndex = p;
-                int hours = currentTime.substring(0, 2).toInt();
-                int minutes = currentTime.substring(3, 5).toInt();
-                minutes += programs[p].durations[z];
-                while (minutes >= 60) {
-                    hours++;
-                    minutes -= 60;
-                }
-                if (hours >= 24) hours -= 24;
-                char endTime[6];
-                sprintf(endTime, "%02d:%02d", hours, minutes);
-                sprinklers[z].calculatedSchedules[1].endTime = String(endTime);
-            
-                currentTime = String(endTime);
-            }
-        }
+/**
+ * @brief Calculates schedules for all sprinklers over yesterday and today.
+ *
+ * The schedule covers a rolling 48 hours starting at yesterday 00:00, so a
+ * program that started late yesterday keeps its remaining zones after
+ * midnight. The new table is built in the back buffer and published with one
+ * pointer swap. On a day rollover prepareNextDaySchedule() has usually built
+ * it already, so only the swap is left; otherwise (or after any program
+ * change, which discards the prepared table) it is built here.
+ * @param dayOfWeek Day of the schedule week (0=Monday, see setScheduleDate()) to calculate schedules for.
+ */
+void ScheduleManager::calculateZoneSchedules(int dayOfWeek) {
+    int32_t today = _weekStartDay + dayOfWeek;
+    ScheduleTable& next = backSchedule();
+    if (!(_prepared && _preparedDay == today)) {
+        buildHorizon(next, today);
     }
-    // --- Program C (index 2) ---
-    p = 2;
+    publishSchedule(next, today);
+}
 
+// Swap a finished back buffer in as the active schedule for today
+void ScheduleManager::publishSchedule(ScheduleTable& table, int32_t today) {
+    _activeSchedule.store(&table, std::memory_order_release);
+    _prepared = false;
+    _horizonDay = today;
+    _horizonBuilt = true;
+    // New boundaries: have loop() re-evaluate zones and re-arm the next transition
+    requestScheduleCheck();
+}
 
-    
+/**
+ * @brief Applies a change to some programs without recomputing the others.
+ *
+ * Occupancy rows are rebuilt only for zoneMask, laying out only the programs
+ * that water those zones. In the active schedule the intervals of the
+ * changed programs are replaced; the rest are copied over as they are. With
+ * program stacking every program can shift every other one, so everything
+ * is rebuilt.
+ * @param programMask Changed programs (bit p = program p)
+ * @param zoneMask Zones the changed programs watered before or water now
+ */
+void ScheduleManager::recalculatePrograms(uint32_t programMask, uint32_t zoneMask) {
+    if (programMask == 0) return;
+    rebuildOccupancyIndex(zoneMask);
+    if (!_horizonBuilt) return;  // Built in full by the first calculateZoneSchedules()
+    ScheduleTable& next = backSchedule();
+    if (stackPrograms) {
+        buildHorizon(next, _horizonDay);
+    } else {
+        next.rebaseFrom(activeSchedule(), 0, programMask);
+        appendHorizonDay(next, _horizonDay - 1, 0, programMask);
+        appendHorizonDay(next, _horizonDay, HORIZON_TODAY, programMask);
+        next.finalize(_finalizeScratch);
+    }
+    publishSchedule(next, _horizonDay);
+}
 
-    if (programs[p].enabled && programs[p].daysOfWeek[dayOfWeek]) {
-        String currentTime = programs[p].startTime;
-        if (currentTime.length() == 5) {
-            for (int z = 0; z < count; z++) {
-                if (programs[p].durations[z] == 0) continue;
-            
-                sprinklers[z].calculatedSchedules[2].startTime = currentTime;
-                sprinklers[z].calculatedSchedules[2].programIndex = p;
-                int hours = currentTime.substring(0, 2).toInt();
-                int minutes = currentTime.substring(3, 5).toInt();
-                minutes += programs[p].durations[z];
-                while (minutes >= 60) {
-                    hours++;
-                    minutes -= 60;
-                }
-                if (hours >= 24) hours -= 24;
-                char endTime[6];
-                sprintf(endTime, "%02d:%02d", hours, minutes);
-                sprinklers[z].calculatedSchedules[2].endTime = String(endTime);
-                currentTime = String(endTime);
-            }
+/**
+ * @brief Pre-builds tomorrow's schedule in the back buffer.
+ *
+ * Call from idle time. Every day is laid out with its own month's water
+ * budget, so a month change at midnight still only swaps it in. Any
+ * calculateZoneSchedules() call before then discards it.
+ * @return true if a table was built, false if one is ready or there is no active schedule.
+ */
+bool ScheduleManager::prepareNextDaySchedule() {
+    if (!_horizonBuilt || _prepared) return false;
+    int32_t tomorrow = _horizonDay + 1;
+    buildHorizon(backSchedule(), tomorrow);
+    _preparedDay = tomorrow;
+    _prepared = true;
+    return true;
+}
+
+
+/**
+ * @brief Sets the date the schedule is built for.
+ *
+ * Interval and odd/even recurrences do not repeat weekly, so the occupancy
+ * index holds one concrete calendar week (Monday to Sunday) and calendar-based
+ * day numbers resolve against it.
+ * @param epochDay Today's date (days since 1970-01-01)
+ * @return True if the week changed; the occupancy index is stale until refreshOccupancyIndex()
+ */
+bool ScheduleManager::setScheduleDate(int32_t epochDay) {
+    int32_t weekStart = epochDay - weekdayFromEpochDay(epochDay);
+    if (weekStart == _weekStartDay) return false;
+    _weekStartDay = weekStart;
+    _occupancyStale = true;
+    return true;
+}
+
+bool ScheduleManager::refreshOccupancyIndex() {
+    if (!_occupancyStale) return false;
+    rebuildOccupancyIndex();
+    return true;
+}
+
+/**
+ * @brief Finds the next minute at which any zone's scheduled state may change.
+ *
+ * The next interval start or end in the active schedule, the same table the
+ * relays follow. Midnight (1440) is always a boundary because the next day's
+ * table is swapped in then.
+ * @param currentMinute Minutes since midnight
+ * @return Minute of day of the next transition, or 1440 for midnight
+ */
+int ScheduleManager::nextTransitionMinute(int currentMinute) const {
+    int boundary = activeSchedule().nextBoundary(HORIZON_TODAY + currentMinute);
+    if (boundary < 0 || boundary - HORIZON_TODAY > 1440) return 1440;
+    return boundary - HORIZON_TODAY;
+}
+
+/**
+ * @brief Rebuilds the minute-of-week occupancy bitmap from the program definitions.
+ *
+ * Called at boot (loadPrograms), whenever programs are saved, copied or reset, and from
+ * idle time via refreshOccupancyIndex() after the week changes.
+ * Runs that continue past midnight carry into the next day's minutes, including
+ * runs from the Sunday before the week into its Monday.
+ * @param zoneMask Zones to rebuild (bit z = zone z); the other rows are kept
+ */
+void ScheduleManager::rebuildOccupancyIndex(uint32_t zoneMask) {
+    // Stacked programs shift each other, so any change can move any zone; after a week
+    // change every row belongs to the old week
+    if (stackPrograms || _occupancyStale) zoneMask = ALL_ZONES;
+    _occupancyStale = false;
+    // Only programs that water one of the zones need laying out
+    uint32_t programMask = 0;
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        if (programZoneMask(p) & zoneMask) programMask |= 1UL << p;
+    }
+    if (zoneMask == ALL_ZONES) {
+        occupancy.clear();
+        programMask = ALL_PROGRAMS;
+    } else {
+        for (int z = 0; z < count; z++) {
+            if ((zoneMask >> z) & 1) occupancy.clearZone(z);
         }
     }
+    // Start with the day before the week (d = -1) for runs carried into Monday,
+    // and clip at the end of the week instead of wrapping: the week after is a
+    // different calendar week
+    for (int d = -1; d < 7 && programMask != 0; d++) {
+        int dayStart = d * 1440;
+        int numRuns = buildDayRuns(_weekStartDay + d, _dayRuns, programMask);
+        for (int r = 0; r < numRuns; r++) {
+            if (!((zoneMask >> _dayRuns[r].zone) & 1)) continue;
+            int start = dayStart + _dayRuns[r].startMinute;
+            int end = start + _dayRuns[r].duration;
+            if (start < 0) start = 0;
+            if (end > OccupancyIndex::MINUTES_PER_WEEK) end = OccupancyIndex::MINUTES_PER_WEEK;
+            if (end > start) occupancy.setRange(_dayRuns[r].zone, start, end - start);
+        }
+    }
+    requestScheduleCheck();
+}
+
+/**
+ * @brief Arms the deadline for the next schedule pass.
+ *
+ * @param localNow Local time at which the current schedule pass ran
+ */
+void ScheduleManager::armNextTransition(const struct tm& localNow) {
+    int currentMinute = localNow.tm_hour * 60 + localNow.tm_min;
+    struct tm next = localNow;
+    next.tm_hour = 0;
+    next.tm_min = nextTransitionMinute(currentMinute); // mktime() normalizes 1440 to tomorrow 00:00
+    next.tm_sec = 0;
+    next.tm_isdst = -1;
+    nextTransitionTime = mktime(&next);
+    scheduleCheckPending = false;
+}
+
+const uint16_t JitterHistogram::BUCKET_LIMIT_MS[JitterHistogram::BUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100};
+
+void JitterHistogram::record(uint32_t jitterMs) {
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && jitterMs >= BUCKET_LIMIT_MS[bucket]) bucket++;
+    counts[bucket]++;
+    samples++;
+    if (jitterMs > maxMs) maxMs = jitterMs;
+    totalMs += jitterMs;
 }
 
+/**
+ * @brief Records how late a deadline-triggered schedule pass ran.
+ *
+ * @param actualMs Wall-clock time of the pass in milliseconds since the epoch
+ */
+void ScheduleManager::recordTransitionLatency(int64_t actualMs) {
+    int32_t latency = (int32_t)(actualMs - (int64_t)nextTransitionTime * 1000);
+    transitionStats.transitions++;
+    transitionStats.lastLatencyMs = latency;
+    if (latency > transitionStats.maxLatencyMs) transitionStats.maxLatencyMs = latency;
+    transitionStats.totalLatencyMs += latency;
+}
 
 // Batch save: Save all schedules for all sprinklers and days in a single Preferences session
 /**
@@ -335,18 +872,35 @@ void ScheduleManager::savePrograms() {
 
     Preferences prefs;
     prefs.begin("sprinkler_prog", false);
-    StaticJsonDocument<4096> doc;
+    DynamicJsonDocument doc(PROGRAMS_JSON_CAPACITY);
 
-    doc["version"] = 1;
+    doc["version"] = 2;
+    doc["stack"] = stackPrograms;
+    doc["maxValves"] = maxOpenValves;
+    JsonArray cycle = doc.createNestedArray("cycle");
+    JsonArray soak = doc.createNestedArray("soak");
+    JsonArray flow = doc.createNestedArray("flow");
+    for (int z = 0; z < count; z++) {
+        cycle.add(sprinklers[z].maxCycleMinutes);
+        soak.add(sprinklers[z].minSoakMinutes);
+        flow.add(sprinklers[z].flowRate);
+    }
+    doc["supply"] = supplyCapacity;
+    doc["budget"] = waterBudgetPercent;
+    JsonArray monthly = doc.createNestedArray("monthly");
+    for (int m = 0; m < 12; m++) monthly.add(monthlyBudgetPercent[m]);
     JsonArray programsArray = doc.createNestedArray("programs");
     
-    for (int p = 0; p < 3; p++) {
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
         JsonObject program = programsArray.createNestedObject();
-        program["start"] = programs[p].startTime;
+        JsonArray starts = program.createNestedArray("starts");
+        for (int k = 0; k < MAX_START_TIMES; k++) {
+            if (programs[p].startTimes[k] < 1440) starts.add(formatMinuteOfDay(programs[p].startTimes[k]));
+        }
         program["enabled"] = programs[p].enabled;
         
         JsonArray durations = program.createNestedArray("durations");
-        for (int z = 0; z < 8; z++) {
+        for (int z = 0; z < MAX_ZONES; z++) {
             durations.add(programs[p].durations[z]);
         }
         
@@ -354,6 +908,9 @@ void ScheduleManager::savePrograms() {
         for (int d = 0; d < 7; d++) {
             days.add(programs[p].daysOfWeek[d]);
         }
+        program["recur"] = programs[p].recurrence;
+        program["every"] = programs[p].intervalDays;
+        program["anchor"] = programs[p].intervalAnchorDay;
     }
 
     String json;
@@ -377,7 +934,7 @@ void ScheduleManager::loadPrograms() {
         return;
     }
     
-    StaticJsonDocument<4096> doc;
+    DynamicJsonDocument doc(PROGRAMS_JSON_CAPACITY);
     DeserializationError error = deserializeJson(doc, json);
     
     if (error) {
@@ -386,14 +943,41 @@ void ScheduleManager::loadPrograms() {
         return;
     }
     
+    stackPrograms = doc["stack"] | false;
+    maxOpenValves = doc["maxValves"] | 1;
+    if (maxOpenValves < 1 || maxOpenValves > MAX_ZONES) maxOpenValves = 1;
+    for (int z = 0; z < count; z++) {
+        sprinklers[z].maxCycleMinutes = doc["cycle"][z] | 0;
+        sprinklers[z].minSoakMinutes = doc["soak"][z] | 0;
+        sprinklers[z].flowRate = doc["flow"][z] | 0;
+    }
+    supplyCapacity = doc["supply"] | 0;
+    waterBudgetPercent = doc["budget"] | 100;
+    for (int m = 0; m < 12; m++) monthlyBudgetPercent[m] = doc["monthly"][m] | 100;
+
     // Load program configurations
-    for (int p = 0; p < 3; p++) {
-        const char* startTime = doc["programs"][p]["start"];
-        programs[p].startTime = startTime ? String(startTime) : "";
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        // Version 2 stores a "starts" array; version 1 a single "start" string
+        for (int k = 0; k < MAX_START_TIMES; k++) {
+            programs[p].startTimes[k] = NO_START_TIME;
+        }
+        JsonVariant starts = doc["programs"][p]["starts"];
+        if (!starts.isNull()) {
+            int numStarts = 0;
+            for (int k = 0; k < MAX_START_TIMES; k++) {
+                const char* text = starts[k];
+                int minute = text ? parseMinuteOfDay(String(text)) : -1;
+                if (minute >= 0) programs[p].startTimes[numStarts++] = minute;
+            }
+        } else {
+            const char* startTime = doc["programs"][p]["start"];
+            int minute = startTime ? parseMinuteOfDay(String(startTime)) : -1;
+            if (minute >= 0) programs[p].startTimes[0] = minute;
+        }
         programs[p].enabled = doc["programs"][p]["enabled"] | false;
         
         // Load durations for each zone
-        for (int z = 0; z < 8; z++) {
+        for (int z = 0; z < MAX_ZONES; z++) {
             programs[p].durations[z] = doc["programs"][p]["durations"][z];
         }
         
@@ -401,9 +985,15 @@ void ScheduleManager::loadPrograms() {
         for (int d = 0; d < 7; d++) {
             programs[p].daysOfWeek[d] = doc["programs"][p]["days"][d];
         }
+
+        // Recurrence (absent before interval/odd-even support: weekdays)
+        programs[p].recurrence = doc["programs"][p]["recur"] | (int)RECUR_WEEKDAYS;
+        if (programs[p].recurrence >= RECUR_TYPE_COUNT) programs[p].recurrence = RECUR_WEEKDAYS;
+        programs[p].intervalDays = doc["programs"][p]["every"] | 1;
+        programs[p].intervalAnchorDay = doc["programs"][p]["anchor"] | 0;
     }
     
-
+    rebuildOccupancyIndex();
 }
 
 Sprinkler& ScheduleManager::getSprinkler(int index) {
@@ -416,10 +1006,9 @@ Sprinkler& ScheduleManager::getSprinkler(int index) {
 
 bool ScheduleManager::checkSprinklerSchedule(
     int sprinklerIndex, 
-    int today, 
     int currentHour, 
     int currentMinute
-) {
+) const {
     if (sprinklerIndex < 0 || sprinklerIndex >= count) 
         return false;
 
@@ -427,57 +1016,38 @@ bool ScheduleManager::checkSprinklerSchedule(
     if (sprinklers[sprinklerIndex].disabled)
         return false;
 
-    int currentTotal = currentHour * 60 + currentMinute;
-
-    // Check each calculated schedule for this sprinkler
-    for (int p = 0; p < 3; p++) {
-        CalculatedSchedule& schedule = sprinklers[sprinklerIndex].calculatedSchedules[p];
-        
-        // Skip if no valid schedule
-        if (schedule.startTime.length() != 5 || schedule.endTime.length() != 5)
-            continue;
-            
-        int startHour = schedule.startTime.substring(0, 2).toInt();
-        int startMin  = schedule.startTime.substring(3, 5).toInt();
-        int endHour   = schedule.endTime.substring(0, 2).toInt();
-        int endMin    = schedule.endTime.substring(3, 5).toInt();
-
-        int startTotal = startHour * 60 + startMin;
-        int endTotal = endHour * 60 + endMin;
-
-        // Check if current time falls within the schedule
-        if (startTotal < endTotal) {
-            if (currentTotal >= startTotal && currentTotal < endTotal) {
-                return true;
-            }
-        } else if (startTotal > endTotal) { // Handles midnight crossing
-            if (currentTotal >= startTotal || currentTotal < endTotal) {
-                return true;
-            }
-        }
-    }
-
-    return false;
+    // Binary search in the published table (includes runs carried over midnight)
+    return activeSchedule().isOn(sprinklerIndex, HORIZON_TODAY + currentHour * 60 + currentMinute);
 }
 
 bool ScheduleManager::verifyPrograms() {
     // Verify all programs have valid configurations
-    for (int p = 0; p < 3; p++) {
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
         if (!programs[p].enabled) continue;
         
-        // Check start time format
-        if (programs[p].startTime.length() != 5) return false;
-        if (programs[p].startTime[2] != ':') return false;
-        
-        // Check if at least one day is selected
-        bool hasDay = false;
-        for (int d = 0; d < 7; d++) {
-            if (programs[p].daysOfWeek[d]) {
-                hasDay = true;
+        // Check for at least one valid start time
+        bool hasStart = false;
+        for (int k = 0; k < MAX_START_TIMES; k++) {
+            if (programs[p].startTimes[k] < 1440) {
+                hasStart = true;
                 break;
             }
         }
-        if (!hasDay) return false;
+        if (!hasStart) return false;
+        
+        // Check the recurrence: weekdays need at least one day selected
+        if (programs[p].recurrence == RECUR_INTERVAL) {
+            if (programs[p].intervalDays < 1) return false;
+        } else if (programs[p].recurrence == RECUR_WEEKDAYS) {
+            bool hasDay = false;
+            for (int d = 0; d < 7; d++) {
+                if (programs[p].daysOfWeek[d]) {
+                    hasDay = true;
+                    break;
+                }
+            }
+            if (!hasDay) return false;
+        }
         
         // Check if at least one zone has a duration
         bool hasDuration = false;
@@ -2,20 +2,85 @@
 #define SCHEDULE_H
 
 #include <Arduino.h>
+#include <time.h>
+#include <atomic>
+#include "config.h"
+#include "occupancy_index.h"
+#include "schedule_table.h"
+#include "epoch_day.h"
+#include "run_arbiter.h"
 
 class SprinklerController;
 
+// Marks an unused entry in Program::startTimes
+#define NO_START_TIME 0xFFFF
+
+// How a program picks its run days
+enum RecurrenceType {
+    RECUR_WEEKDAYS = 0,  // The days set in daysOfWeek
+    RECUR_INTERVAL,      // Every intervalDays days, counted from intervalAnchorDay
+    RECUR_ODD_DAYS,      // Odd days of the month (1st, 3rd, ... 31st)
+    RECUR_EVEN_DAYS,     // Even days of the month
+    RECUR_TYPE_COUNT
+};
+
 struct Program {
-    String startTime;           // Initial start time for the program (HH:mm)
-    uint16_t durations[8];     // Duration in minutes for each zone
+    uint16_t startTimes[MAX_START_TIMES]; // Start times in minutes since midnight (NO_START_TIME = unused)
+    uint16_t durations[MAX_ZONES]; // Duration in minutes for each zone
     bool enabled;              // Whether this program is active
     bool daysOfWeek[7];       // Which days this program runs (0=Monday to 6=Sunday)
+    uint8_t recurrence;        // RecurrenceType
+    uint8_t intervalDays;      // RECUR_INTERVAL: run every N days (1-30)
+    int32_t intervalAnchorDay; // RECUR_INTERVAL: epoch day of one run day
+};
+
+// True if both programs have the same settings (used to find which programs a save changed)
+bool programsEqual(const Program& a, const Program& b);
+// True if the program's recurrence includes the given epoch day (O(1); ignores enabled)
+bool programRunsOnDay(const Program& program, int32_t epochDay);
+// Fill out with the next run days on or after fromDay, without stepping day by day;
+// returns how many were written (at most maxDays)
+int forecastRunDays(const Program& program, int32_t fromDay, int32_t* out, int maxDays);
+
+// One zone run laid out by the schedule engine for a single program start
+struct ZoneRun {
+    uint16_t startMinute;     // Minutes since midnight of the program's day (may pass 1439)
+    uint16_t duration;        // Run length in minutes
+    uint8_t zone;             // Zone index (0-based)
+    uint8_t programIndex;     // Program this run belongs to (0 = A)
+    uint8_t startIndex;       // Which of the program's start times this run belongs to
+};
+
+// Parse "HH:mm" into minutes since midnight. Returns -1 if the string is not a valid time.
+int parseMinuteOfDay(const String& hhmm);
+// Format minutes since midnight as "HH:mm" (wraps past midnight)
+String formatMinuteOfDay(int minuteOfDay);
+// Parse "YYYY-MM-DD" into an epoch day. Returns false if the string is not a valid date.
+bool parseEpochDay(const String& date, int32_t& epochDay);
+// Format an epoch day as "YYYY-MM-DD"
+String formatEpochDay(int32_t epochDay);
+
+// Display letter for a program index (0 = 'A')
+inline char programLetter(int programIndex) { return (char)('A' + programIndex); }
+
+// Requested vs actual timing of deadline-triggered schedule passes
+struct TransitionLatencyStats {
+    uint32_t transitions = 0;      // Number of passes triggered by an armed deadline
+    int32_t lastLatencyMs = 0;     // Actual minus requested time of the latest transition
+    int32_t maxLatencyMs = 0;      // Worst latency seen since boot
+    int64_t totalLatencyMs = 0;    // Sum of latencies, for the average
 };
 
-struct CalculatedSchedule {
-    String startTime;          // Calculated start time for this zone
-    String endTime;           // Calculated end time for this zone
-    uint8_t programIndex;     // Which program this schedule belongs to (0-2)
+// Scheduled vs actual switch time of Quick Run / Run Program Now zone transitions
+struct JitterHistogram {
+    static const int BUCKETS = 8;
+    static const uint16_t BUCKET_LIMIT_MS[BUCKETS - 1]; // Upper bounds (exclusive); the last bucket is open
+    uint32_t counts[BUCKETS] = {};
+    uint32_t samples = 0;
+    uint32_t maxMs = 0;
+    uint64_t totalMs = 0;
+
+    void record(uint32_t jitterMs);
 };
 
 class Sprinkler {
@@ -23,7 +88,9 @@ public:
     Sprinkler();
     void init(int zoneIndex, SprinklerController* controller); // zoneIndex instead of pin
     void setState(bool on);
-    CalculatedSchedule calculatedSchedules[3];  // Up to 3 run times per day from different programs
+    uint16_t maxCycleMinutes;  // Cycle-and-soak: longest single run in minutes (0 = no split)
+    uint16_t minSoakMinutes;   // Cycle-and-soak: minimum pause between cycles in minutes
+    uint16_t flowRate;         // Flow in liters per minute (0 = unknown, runs alone under a flow budget)
     bool state;
     bool disabled;
     int zone; // zone index (0-based)
@@ -33,28 +100,60 @@ private:
 
 class ScheduleManager {
 public:
-    int currentRunNowProgramIndex = -1; // -1 if none, else 0/1/2 for A/B/C
-    // --- Run Program Now state ---
-    bool runProgramNowActive = false;
-    int runProgramNowPendingZones[8];
-    int runProgramNowNumZones = 0;
-    int runProgramNowZoneIndex = 0;
-    int runProgramNowCurrentZone = -1;
-    unsigned long runProgramNowStartTime = 0;
-    unsigned long runProgramNowDurationPerZone = 0;
+    // Schedule, manual, Quick Run and Run Program Now runs; the control task
+    // opens the zones of whichever has priority
+    RunArbiter runs;
 public:
     ScheduleManager(int num, SprinklerController* controller); // Pass controller
-    void updateRunProgramNow();
     // Stop Run Program Now for all programs
     void stopRunProgramNow();
     ~ScheduleManager();
     void initializePrograms();
-    void calculateZoneSchedules(int dayOfWeek);  // Calculate start/end times for all zones
+    void calculateZoneSchedules(int dayOfWeek);  // Calculate start/end times for all zones (day of the schedule week)
+    // Build the day after the active schedule in the back buffer so the next
+    // calculateZoneSchedules() only swaps it in; returns false if there was nothing to do
+    bool prepareNextDaySchedule();
+    // Set the date the schedule is built for; returns true when it moved to another
+    // week, which leaves the occupancy index stale until refreshOccupancyIndex()
+    bool setScheduleDate(int32_t epochDay);
+    // Rebuild the occupancy index if the week changed (idle time, not the rollover pass);
+    // returns false if it was current
+    bool refreshOccupancyIndex();
+    int32_t scheduleWeekStart() const { return _weekStartDay; }  // Epoch day of the indexed week's Monday
     void savePrograms();
     void loadPrograms();
     void printPrograms();
     Sprinkler& getSprinkler(int index);
-    bool checkSprinklerSchedule(int sprinklerIndex, int today, int currentHour, int currentMinute);
+    // True if the active schedule has the zone on at that time today (false if disabled)
+    bool checkSprinklerSchedule(int sprinklerIndex, int currentHour, int currentMinute) const;
+    // Lay out one start of a program with cycle-and-soak and flow-budget packing, at the
+    // current month's water budget; returns the number of runs written to out (capacity MAX_RUNS_PER_START)
+    static const int MAX_RUNS_PER_START = MAX_ZONES * MAX_CYCLES_PER_ZONE;
+    int layoutProgramStart(int programIndex, int startMinute, int startIndex, ZoneRun* out,
+                           bool skipDisabled = false) const;
+    // Watering window of one program start: packed layout vs. every zone's cycles back to back
+    void programWindowMinutes(int programIndex, int& packedMinutes, int& sequentialMinutes) const;
+    // Lay out one program's zone runs for every start time on a day; returns the
+    // number of runs written to out (capacity MAX_RUNS_PER_PROGRAM)
+    static const int MAX_RUNS_PER_PROGRAM = MAX_RUNS_PER_START * MAX_START_TIMES;
+    int buildProgramRuns(int programIndex, int32_t epochDay, ZoneRun* out) const;
+    static const uint32_t ALL_PROGRAMS = (1UL << NUM_PROGRAMS) - 1;  // Program mask: bit p = program p
+    static const uint32_t ALL_ZONES = 0xFFFFFFFFUL;                  // Zone mask: bit z = zone z
+    // Lay out the programs in programMask for a day, stacked if enabled (full mask only);
+    // returns the number of runs written to out (capacity MAX_RUNS_PER_DAY)
+    static const int MAX_RUNS_PER_DAY = NUM_PROGRAMS * MAX_RUNS_PER_PROGRAM;
+    int buildDayRuns(int32_t epochDay, ZoneRun* out, uint32_t programMask = ALL_PROGRAMS) const;
+    static bool isValidProgramIndex(int programIndex) { return programIndex >= 0 && programIndex < NUM_PROGRAMS; }
+    // RAM one manager takes for num zones: the object (programs, both schedule tables), its
+    // zones, the day-runs and finalize scratch and the occupancy rows
+    static size_t footprintBytes(int num);
+    uint32_t programZoneMask(int programIndex) const;  // Zones the program waters
+    // Rebuild the minute-of-week bitmap from programs[], only the rows of zones in zoneMask
+    void rebuildOccupancyIndex(uint32_t zoneMask = ALL_ZONES);
+    // After changing programs in programMask: rebuild the occupancy rows of zoneMask (every
+    // zone the programs watered before or water now) and re-lay only those programs'
+    // intervals in the active schedule
+    void recalculatePrograms(uint32_t programMask, uint32_t zoneMask);
     bool verifyPrograms();
     bool verifySchedules();  // Verify program configurations
 
@@ -66,27 +165,85 @@ public:
     void copyProgram(int targetIndex, int sourceIndex);
     void clearAllPreferences();  // Clear all program data from Preferences
     
-    Program programs[3];        // 3 available programs (A, B, C)
+    Program programs[NUM_PROGRAMS]; // Available programs (A, B, C, ...)
     Sprinkler* sprinklers;      // Array of sprinkler objects
     int count;                  // Number of sprinklers
+    OccupancyIndex occupancy;   // Minute-of-week run bitmap per zone for range queries (relays use activeSchedule())
+    // Published schedule: sorted per-zone intervals for yesterday and today, in minutes
+    // from yesterday 00:00, so runs carried over midnight stay visible. Tables are built
+    // off to the side and published whole, so the returned table is never half-built;
+    // don't hold the reference across the next calculateZoneSchedules()
+    const ScheduleTable& activeSchedule() const { return *_activeSchedule.load(std::memory_order_acquire); }
+    static const int HORIZON_TODAY = 1440;     // Horizon minute of today 00:00
+
+    // --- Program stacking ---
+    // When enabled, overlapping programs are merged into one queue at calculation
+    // time so no more than maxOpenValves zones are ever scheduled at once.
+    bool stackPrograms = false;                // Queue overlapping runs instead of running them concurrently
+    int maxOpenValves = 1;                     // Valves allowed open at once while stacking (1..MAX_ZONES)
 
-    // --- Quick Run State and Methods ---
-    bool quickRunActive = false;               // Is Quick Run running?
-    int quickRunCurrentZone = -1;              // Index of zone currently running
-    unsigned long quickRunStartTime = 0;       // When did current zone start (millis)
-    int quickRunDurationPerZone = 10000;       // Duration per zone in ms (default 10 sec)
-    int quickRunPendingZones[8];               // Indices of zones to run (max 8 zones)
-    int quickRunNumZones = 0;                  // How many zones in this session
-    int quickRunZoneIndex = 0;                 // Which zone in pending list is running
-
-    void startQuickRun(int durationSeconds, int programIndex);
-    void startRunProgramNow(int programIndex); // Called when Run Program Now is triggered
-    int getCurrentRunProgramNowIndex() const { return currentRunNowProgramIndex; }
+    // --- Flow budget ---
+    // With a supply capacity set, a program runs several zones at once as long
+    // as their combined flowRate fits; 0 keeps strict one-zone-at-a-time runs.
+    uint16_t supplyCapacity = 0;               // Site supply in liters per minute (0 = off)
+
+    // --- Seasonal water budget ---
+    // Durations are scaled when runs are laid out, each day with its own
+    // month's percentage; the stored program durations never change, so a new
+    // season does not rewrite flash.
+    uint16_t waterBudgetPercent = 100;         // Global scale, percent (0..MAX_BUDGET_PERCENT)
+    uint16_t monthlyBudgetPercent[12];         // Per-month scale, percent, January first
+    static const uint16_t MAX_BUDGET_PERCENT = 300;
+    // Set the current month (0 = January) for Run Program Now and the program page; returns
+    // true if its scale changed. Schedule days are laid out with their own month's scale.
+    bool updateWaterBudget(int month);
+    uint32_t budgetScaleQ16() const { return _budgetScaleQ16; }  // Current month's scale, 16.16 fixed point
+    uint16_t budgetedDuration(uint16_t minutes) const;           // minutes scaled by the current budget, rounded
+
+    // --- Quick Run and Run Program Now (timed runs in runs) ---
+    void startQuickRun(uint32_t durationSeconds, int programIndex);
+    bool startRunProgramNow(int programIndex); // Called when Run Program Now is triggered; false if it cannot run
+    int getCurrentRunProgramNowIndex() const { return runs.program(RunSource::RunProgramNow); }
     void stopQuickRun();
-    void updateQuickRun();
     bool isQuickRunActive() const;
+    // MonotonicClock time at which the timed run in control (Run Program Now, Quick Run) next switches a zone; false if none is
+    bool nextRunTransition(uint64_t& atMs) const;
+    JitterHistogram runTransitionJitter;
+
+    // --- Event-driven schedule transitions ---
+    // Instead of polling, loop() runs the schedule pass only when the next
+    // start/end boundary (or midnight) is reached, or when state changed.
+    time_t nextTransitionTime = 0;             // Epoch time of the armed deadline
+    bool scheduleCheckPending = true;          // Set when programs/zones/time changed
+    TransitionLatencyStats transitionStats;
+
+    int nextTransitionMinute(int currentMinute) const; // Next change after currentMinute (1440 = midnight)
+    void requestScheduleCheck() { scheduleCheckPending = true; }
+    bool isScheduleCheckDue(time_t now) const { return scheduleCheckPending || now >= nextTransitionTime; }
+    void armNextTransition(const struct tm& localNow);
+    void recordTransitionLatency(int64_t actualMs);
 private:
     SprinklerController* _controller;
+    ZoneRun* _dayRuns;                         // Scratch for buildDayRuns() (MAX_RUNS_PER_DAY entries)
+    ZoneInterval* _finalizeScratch;            // Scratch for ScheduleTable::finalize() (CAPACITY entries)
+    uint32_t _budgetScaleQ16 = 1UL << 16;      // waterBudgetPercent x current month's percent, 16.16 fixed point
+    int32_t _weekStartDay = -3;                // Monday of the week in occupancy (-3 = week of 1970-01-01)
+    ScheduleTable _schedules[2];               // Active and back buffer of the schedule horizon
+    std::atomic<ScheduleTable*> _activeSchedule{&_schedules[0]};
+    int32_t _horizonDay = 0;                   // Epoch day of "today" in the active schedule
+    bool _horizonBuilt = false;
+    int32_t _preparedDay = 0;                  // Epoch day the back buffer was pre-built for
+    bool _prepared = false;
+    bool _occupancyStale = false;              // The week changed since the last full rebuildOccupancyIndex()
+    ScheduleTable& backSchedule() { return *(activeSchedulePtr() == &_schedules[0] ? &_schedules[1] : &_schedules[0]); }
+    ScheduleTable* activeSchedulePtr() const { return _activeSchedule.load(std::memory_order_relaxed); }
+    uint32_t budgetScaleForMonth(int month) const;
+    uint32_t budgetScaleForDay(int32_t epochDay) const;
+    int layoutStart(int programIndex, int startMinute, int startIndex, ZoneRun* out, bool skipDisabled,
+                    uint32_t scaleQ16) const;
+    void appendHorizonDay(ScheduleTable& table, int32_t epochDay, int offset, uint32_t programMask = ALL_PROGRAMS);
+    void buildHorizon(ScheduleTable& table, int32_t today);
+    void publishSchedule(ScheduleTable& table, int32_t today);
 };
 
 #endif // SCHEDULE_H
\ No newline at end of file
@@ -0,0 +1,478 @@
+/**
+ * @file schedule_bench.cpp
+ * @brief On-device benchmarks for the schedule evaluation path.
+ *
+ * Compares the legacy String-based schedule check against the integer schedule table.
+ */
+
+#include "schedule_bench.h"
+#include "control_task.h"
+#include "deep_sleep.h"
+#include "event_log.h"
+#include "monotonic_clock.h"
+#include "sprinkler_controller.h"
+#include "sprinkler_system_state.h"
+#include "wall_clock.h"
+
+// Legacy representation: the String start/end pair each schedule slot used to hold
+struct LegacySchedule {
+    String startTime;
+    String endTime;
+};
+
+// The per-zone check exactly as loop() and checkSprinklerSchedule() did it before the table,
+// scanning every slot of the zone
+static bool legacyShouldBeOn(const LegacySchedule* slots, int numSlots, int currentTotal) {
+    for (int p = 0; p < numSlots; p++) {
+        const LegacySchedule& schedule = slots[p];
+        if (schedule.startTime.length() != 5 || schedule.endTime.length() != 5) continue;
+        int startHour = schedule.startTime.substring(0, 2).toInt();
+        int startMin  = schedule.startTime.substring(3, 5).toInt();
+        int endHour   = schedule.endTime.substring(0, 2).toInt();
+        int endMin    = schedule.endTime.substring(3, 5).toInt();
+        int startTotal = startHour * 60 + startMin;
+        int endTotal = endHour * 60 + endMin;
+        if (startTotal < endTotal) {
+            if (currentTotal >= startTotal && currentTotal < endTotal) return true;
+        } else if (startTotal > endTotal) {
+            if (currentTotal >= startTotal || currentTotal < endTotal) return true;
+        }
+    }
+    return false;
+}
+
+ScheduleBenchResult runScheduleTickBenchmark(ScheduleManager& scheduleManager, uint32_t ticks) {
+    ScheduleBenchResult result = {ticks, 0, 0, 0, 0, 0, 0};
+    int count = scheduleManager.count;
+
+    // Rebuild the legacy String slots from today's part of the horizon so both paths see
+    // the same schedule; yesterday's carry-over is clipped at midnight
+    const ScheduleTable& table = scheduleManager.activeSchedule();
+    const int today = ScheduleManager::HORIZON_TODAY;
+    LegacySchedule* legacy = new LegacySchedule[table.size() > 0 ? table.size() : 1];
+    int legacyStart[MAX_ZONES + 1];
+    int numLegacy = 0;
+    for (int z = 0; z < count; z++) {
+        legacyStart[z] = numLegacy;
+        const ZoneInterval* intervals = table.zoneIntervals(z);
+        for (int i = 0; i < table.zoneIntervalCount(z); i++) {
+            int startMinute = intervals[i].startMinute > today ? intervals[i].startMinute : today;
+            int endMinute = intervals[i].endMinute < today + 1440 ? intervals[i].endMinute : today + 1440;
+            if (endMinute <= startMinute) continue;
+            legacy[numLegacy].startTime = formatMinuteOfDay(startMinute - today);
+            legacy[numLegacy].endTime = formatMinuteOfDay(endMinute - today);
+            numLegacy++;
+        }
+    }
+    legacyStart[count] = numLegacy;
+
+    // Step through the day with a stride coprime to 1440 so every minute gets visited
+    unsigned long start = micros();
+    for (uint32_t t = 0; t < ticks; t++) {
+        int minute = (t * 7) % 1440;
+        for (int z = 0; z < count; z++) {
+            if (legacyShouldBeOn(&legacy[legacyStart[z]], legacyStart[z + 1] - legacyStart[z], minute)) result.legacyOnCount++;
+        }
+    }
+    result.legacyMicros = micros() - start;
+
+    start = micros();
+    for (uint32_t t = 0; t < ticks; t++) {
+        int minute = (t * 7) % 1440;
+        for (int z = 0; z < count; z++) {
+            if (table.isOn(z, today + minute)) result.tableOnCount++;
+        }
+    }
+    result.tableMicros = micros() - start;
+
+    struct tm timeinfo;
+    WallClock::localNow(timeinfo);
+    int dayOfWeek = (timeinfo.tm_wday + 6) % 7;
+    start = micros();
+    for (uint32_t t = 0; t < ticks; t++) {
+        int minuteOfWeek = OccupancyIndex::minuteOfWeek(dayOfWeek, (t * 7) % 1440);
+        for (int z = 0; z < count; z++) {
+            if (scheduleManager.occupancy.isOn(z, minuteOfWeek)) result.bitmapOnCount++;
+        }
+    }
+    result.bitmapMicros = micros() - start;
+
+    delete[] legacy;
+    return result;
+}
+
+String scheduleBenchToJson(const ScheduleBenchResult& result) {
+    String json = "{";
+    json += "\"ticks\":" + String(result.ticks);
+    json += ",\"legacyMicros\":" + String(result.legacyMicros);
+    json += ",\"tableMicros\":" + String(result.tableMicros);
+    json += ",\"bitmapMicros\":" + String(result.bitmapMicros);
+    json += ",\"legacyPerTickMicros\":" + String(result.ticks ? (float)result.legacyMicros / result.ticks : 0.0f, 3);
+    json += ",\"tablePerTickMicros\":" + String(result.ticks ? (float)result.tableMicros / result.ticks : 0.0f, 3);
+    json += ",\"bitmapPerTickMicros\":" + String(result.ticks ? (float)result.bitmapMicros / result.ticks : 0.0f, 3);
+    json += ",\"legacyOnCount\":" + String(result.legacyOnCount);
+    json += ",\"tableOnCount\":" + String(result.tableOnCount);
+    json += ",\"bitmapOnCount\":" + String(result.bitmapOnCount);
+    json += "}";
+    return json;
+}
+
+// Heap left for WiFi, the web server and the response after the scratch manager
+static const uint32_t COMPUTE_BENCH_HEAP_RESERVE = 32768;
+
+ScheduleComputeBenchResult runScheduleComputeBenchmark(uint32_t iterations) {
+    ScheduleComputeBenchResult result = {};
+    result.programs = NUM_PROGRAMS;
+    result.zones = MAX_ZONES;
+    result.iterations = iterations;
+    result.managerBytes = ScheduleManager::footprintBytes(MAX_ZONES);
+    result.tableBytes = sizeof(ScheduleTable);
+    // A failed allocation aborts, so check first; the object itself (both tables) is one block
+    result.freeHeapBytes = ESP.getFreeHeap();
+    if (result.freeHeapBytes < result.managerBytes + COMPUTE_BENCH_HEAP_RESERVE ||
+        ESP.getMaxAllocHeap() < sizeof(ScheduleManager)) {
+        return result;
+    }
+    result.ran = true;
+
+    // Synthetic worst case: every program enabled every day with every start time in use,
+    // every zone with a duration. Heap-allocated: the schedule table is too big for the stack.
+    ScheduleManager* benchManager = new ScheduleManager(MAX_ZONES, nullptr);
+    ScheduleManager& bench = *benchManager;
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        Program& program = bench.programs[p];
+        for (int k = 0; k < MAX_START_TIMES; k++) {
+            program.startTimes[k] = (p * 90 + k * (1440 / MAX_START_TIMES)) % 1440;
+        }
+        program.enabled = false;
+        for (int z = 0; z < MAX_ZONES; z++) program.durations[z] = 5 + (z % 4);
+        for (int d = 0; d < 7; d++) program.daysOfWeek[d] = true;
+    }
+
+    // Daily table cost with 1..NUM_PROGRAMS programs enabled, to show linear scaling
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        bench.programs[p].enabled = true;
+        unsigned long start = micros();
+        for (uint32_t i = 0; i < iterations; i++) {
+            bench.calculateZoneSchedules(i % 7);
+        }
+        result.dailyMicros[p] = micros() - start;
+    }
+
+    unsigned long start = micros();
+    for (uint32_t i = 0; i < iterations; i++) {
+        bench.rebuildOccupancyIndex();
+    }
+    result.weeklyIndexMicros = micros() - start;
+
+    // Saving a change to one program: only its intervals and zones are recomputed
+    Program& changed = bench.programs[0];
+    start = micros();
+    for (uint32_t i = 0; i < iterations; i++) {
+        changed.durations[0] = 5 + (i & 1);
+        bench.recalculatePrograms(1UL << 0, bench.programZoneMask(0));
+    }
+    result.programChangeMicros = micros() - start;
+    delete benchManager;
+    return result;
+}
+
+String scheduleComputeBenchToJson(const ScheduleComputeBenchResult& result) {
+    uint32_t iterations = result.iterations ? result.iterations : 1;
+    String json = "{";
+    json += "\"programs\":" + String(result.programs);
+    json += ",\"zones\":" + String(result.zones);
+    json += ",\"iterations\":" + String(result.iterations);
+    json += ",\"dailyMicrosByEnabledPrograms\":[";
+    for (int p = 0; p < result.programs; p++) {
+        json += String((float)result.dailyMicros[p] / iterations, 2);
+        if (p < result.programs - 1) json += ",";
+    }
+    json += "]";
+    json += ",\"weeklyIndexMicros\":" + String((float)result.weeklyIndexMicros / iterations, 2);
+    json += ",\"programChangeMicros\":" + String((float)result.programChangeMicros / iterations, 2);
+    json += ",\"managerBytes\":" + String(result.managerBytes);
+    json += ",\"tableBytes\":" + String(result.tableBytes);
+    json += ",\"freeHeapBytes\":" + String(result.freeHeapBytes);
+    json += ",\"ran\":" + String(result.ran ? "true" : "false");
+    if (!result.ran) json += ",\"error\":\"Not enough heap for a scratch manager: cap SCHEDULE_TABLE_CAPACITY\"";
+    json += "}";
+    return json;
+}
+
+RunTickBenchResult runRunTickBenchmark(uint32_t ticks) {
+    RunTickBenchResult result;
+    result.ticks = ticks;
+    result.segments = RunArbiter::MAX_SEGMENTS;
+    result.maskChanges = 0;
+
+    // Heap-allocated: each run slot holds MAX_SEGMENTS segments
+    RunArbiter* arbiter = new RunArbiter();
+    RunSegment* segments = new RunSegment[RunArbiter::MAX_SEGMENTS];
+    for (int i = 0; i < RunArbiter::MAX_SEGMENTS; i++) {
+        segments[i].startMs = (uint32_t)i * 60000;
+        segments[i].endMs = segments[i].startMs + 60000;
+        segments[i].zone = i % MAX_ZONES;
+    }
+    const uint32_t runProgramNowMs = (uint32_t)RunArbiter::MAX_SEGMENTS * 60000;
+    arbiter->startTimed(RunSource::QuickRun, 0, segments, MAX_ZONES, 0);
+    arbiter->startTimed(RunSource::RunProgramNow, 0, segments, RunArbiter::MAX_SEGMENTS, 0);
+    arbiter->hold(RunSource::Manual, 0x5);
+    arbiter->hold(RunSource::Schedule, 0xA);
+    delete[] segments;
+
+    // Sweep the Run Program Now, then the Quick Run that resumes after it
+    const uint32_t spanMs = runProgramNowMs + (uint32_t)MAX_ZONES * 60000;
+    const uint32_t stepMs = ticks ? spanMs / ticks + 1 : spanMs;
+    uint32_t lastMask = 0;
+    uint64_t at;
+    unsigned long start = micros();
+    for (uint32_t t = 0; t < ticks; t++) {
+        uint64_t nowMs = (uint64_t)t * stepMs;
+        arbiter->advance(nowMs);
+        uint32_t mask = arbiter->zoneMask(nowMs);
+        arbiter->nextTransition(nowMs, at);
+        if (mask != lastMask) result.maskChanges++;
+        lastMask = mask;
+    }
+    result.arbiterMicros = micros() - start;
+    delete arbiter;
+    return result;
+}
+
+String runTickBenchToJson(const RunTickBenchResult& result) {
+    String json = "{";
+    json += "\"ticks\":" + String(result.ticks);
+    json += ",\"segments\":" + String(result.segments);
+    json += ",\"arbiterMicros\":" + String(result.arbiterMicros);
+    json += ",\"perTickMicros\":" + String(result.ticks ? (float)result.arbiterMicros / result.ticks : 0.0f, 3);
+    json += ",\"maskChanges\":" + String(result.maskChanges);
+    json += "}";
+    return json;
+}
+
+// Three programs over YEAR_SIM_ZONES zones, one per recurrence type the engine has
+static void setUpYearSimPrograms(ScheduleManager& sim, int32_t startDay) {
+    sim.initializePrograms();
+    // Seasonal budget: short runs in winter, long ones in summer
+    static const uint16_t MONTHLY[12] = {40, 50, 70, 90, 110, 130, 150, 140, 110, 80, 50, 40};
+    for (int m = 0; m < 12; m++) sim.monthlyBudgetPercent[m] = MONTHLY[m];
+
+    // A: Monday, Wednesday and Friday, morning and evening, front zones
+    Program& a = sim.programs[0];
+    a.startTimes[0] = 6 * 60;
+    a.startTimes[1] = 18 * 60 + 30;
+    a.daysOfWeek[0] = a.daysOfWeek[2] = a.daysOfWeek[4] = true;
+    a.durations[0] = 10; a.durations[1] = 12; a.durations[2] = 8; a.durations[3] = 15;
+    a.enabled = true;
+
+    // B: every third day at dawn, back zones
+    Program& b = sim.programs[1];
+    b.startTimes[0] = 5 * 60;
+    b.recurrence = RECUR_INTERVAL;
+    b.intervalDays = 3;
+    b.intervalAnchorDay = startDay;
+    b.durations[4] = 20; b.durations[5] = 25; b.durations[6] = 15; b.durations[7] = 30;
+    b.enabled = true;
+
+    // C: odd days late at night, every zone, running past midnight
+    Program& c = sim.programs[2];
+    c.startTimes[0] = 23 * 60 + 30;
+    c.recurrence = RECUR_ODD_DAYS;
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) c.durations[z] = 5;
+    c.enabled = true;
+}
+
+YearSimResult runYearSimulation(uint32_t days, time_t startEpoch, YearSimTraceCallback trace, void* context) {
+    YearSimResult result = {};
+    result.startEpoch = startEpoch;
+    result.days = days;
+
+    // Heap-allocated: the schedule tables are too big for the stack
+    ScheduleManager* sim = new ScheduleManager(YEAR_SIM_ZONES, nullptr);
+    SprinklerController controller(nullptr, nullptr, YEAR_SIM_ZONES, -1); // Tracks the mask only
+    SprinklerSystemState manualState;
+    struct tm startInfo;
+    localtime_r(&startEpoch, &startInfo);
+    setUpYearSimPrograms(*sim, epochDayFromTm(startInfo));
+
+    // Simulated time on this thread only; restored below
+    bool wasManual = MonotonicClock::isManual();
+    uint64_t manualMs = MonotonicClock::nowMs();
+    EventLog::Mute mute;
+    MonotonicClock::setManual(0);
+    WallClock::simulate(startEpoch);
+    ControlTask* task = new ControlTask(*sim, manualState, controller, ControlTask::Mode::Simulation);
+
+    const time_t endEpoch = startEpoch + (time_t)days * 86400;
+    uint32_t lastMask = 0;
+    time_t lastChange = startEpoch;
+    unsigned long start = micros();
+    for (time_t now = WallClock::now(); now < endEpoch; now = WallClock::now()) {
+        task->step();
+        result.passes++;
+        uint32_t mask = controller.appliedZoneMask();
+        if (mask != lastMask) {
+            for (int z = 0; z < YEAR_SIM_ZONES; z++) {
+                if ((lastMask >> z) & 1) result.zoneOnMinutes[z] += (uint32_t)((now - lastChange) / 60);
+            }
+            lastMask = mask;
+            lastChange = now;
+            result.transitions++;
+            if (trace) trace(YearSimTransition{now, mask}, context);
+        }
+        // Jump to the armed schedule deadline (zone start/end or midnight)
+        time_t next = sim->nextTransitionTime < endEpoch ? sim->nextTransitionTime : endEpoch;
+        MonotonicClock::advance(next > now ? (uint64_t)(next - now) * 1000 : 1000);
+    }
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) {
+        if ((lastMask >> z) & 1) result.zoneOnMinutes[z] += (uint32_t)((endEpoch - lastChange) / 60);
+    }
+    result.wallMicros = micros() - start;
+
+    delete task;
+    delete sim;
+    WallClock::useSystem();
+    if (wasManual) {
+        MonotonicClock::setManual(manualMs);
+    } else {
+        MonotonicClock::useSystem();
+    }
+    return result;
+}
+
+String yearSimToJson(const YearSimResult& result, const String& traceJson) {
+    String json = "{";
+    json += "\"startEpoch\":" + String((long)result.startEpoch);
+    json += ",\"days\":" + String(result.days);
+    json += ",\"programs\":" + String(YEAR_SIM_PROGRAMS);
+    json += ",\"zones\":" + String(YEAR_SIM_ZONES);
+    json += ",\"passes\":" + String(result.passes);
+    json += ",\"transitions\":" + String(result.transitions);
+    json += ",\"wallMicros\":" + String(result.wallMicros);
+    json += ",\"zoneOnMinutes\":[";
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) {
+        json += String(result.zoneOnMinutes[z]);
+        if (z < YEAR_SIM_ZONES - 1) json += ",";
+    }
+    json += "]";
+    if (traceJson.length() > 0) json += ",\"trace\":" + traceJson;
+    json += "}";
+    return json;
+}
+
+// Timer wake to the first control pass (ESP32 boot and setup())
+static const uint32_t SIM_BOOT_MS = 300;
+
+DeepSleepSimResult runDeepSleepSimulation(uint32_t days, time_t startEpoch, YearSimTraceCallback trace, void* context) {
+    DeepSleepSimResult result = {};
+    result.startEpoch = startEpoch;
+    result.days = days;
+
+    SprinklerController controller(nullptr, nullptr, YEAR_SIM_ZONES, -1); // Held off through each sleep
+    SprinklerSystemState manualState;
+    DeepSleep sleeper; // Its record stands in for RTC memory
+    struct tm startInfo;
+    localtime_r(&startEpoch, &startInfo);
+    int32_t startDay = epochDayFromTm(startInfo);
+
+    bool wasManual = MonotonicClock::isManual();
+    uint64_t manualMs = MonotonicClock::nowMs();
+    EventLog::Mute mute;
+
+    const time_t endEpoch = startEpoch + (time_t)days * 86400;
+    uint32_t lastMask = 0;
+    time_t lastChange = startEpoch;
+    uint64_t awakeMs = 0;
+    time_t bootAt = startEpoch;
+    bool scheduledWake = false; // The first boot is a power-on
+    unsigned long start = micros();
+    while (bootAt < endEpoch) {
+        // Boot: the clock carries on, RAM (programs reloaded, control state) starts over
+        MonotonicClock::setManual(0);
+        WallClock::simulate(bootAt);
+        sleeper.wake(scheduledWake, 0);
+        MonotonicClock::advance(SIM_BOOT_MS);
+        ScheduleManager* sim = new ScheduleManager(YEAR_SIM_ZONES, nullptr);
+        setUpYearSimPrograms(*sim, startDay);
+        ControlTask* task = new ControlTask(*sim, manualState, controller, ControlTask::Mode::Simulation);
+        bootAt = endEpoch; // Unless a plan below sends it to sleep
+
+        for (time_t now = WallClock::now(); now < endEpoch; now = WallClock::now()) {
+            task->step();
+            uint32_t mask = controller.appliedZoneMask();
+            sleeper.noteZones(mask, MonotonicClock::nowMs(), WallClock::nowMs());
+            if (mask != lastMask) {
+                for (int z = 0; z < YEAR_SIM_ZONES; z++) {
+                    if ((lastMask >> z) & 1) result.zoneOnMinutes[z] += (uint32_t)((now - lastChange) / 60);
+                }
+                lastMask = mask;
+                lastChange = now;
+                result.transitions++;
+                if (trace) trace(YearSimTransition{now, mask}, context);
+            }
+            DeepSleepPlan plan = sleeper.plan(*sim, now, MonotonicClock::nowMs(), UINT64_MAX, mask != 0);
+            if (plan.sleep) {
+                // Record only: DeepSleep::sleep() would put the real chip to sleep
+                controller.applyZoneMask(0);
+                sleeper.noteSleep(plan);
+                result.sleeps++;
+                if (plan.eventAt != 0) result.scheduledWakes++;
+                bootAt = plan.wakeAt;
+                break;
+            }
+            // Jump to the schedule deadline to the millisecond (the boot left the clock mid-second),
+            // or to the end of the power-on grace period if that comes first
+            int64_t nowMs = WallClock::nowMs();
+            time_t next = sim->nextTransitionTime < endEpoch ? sim->nextTransitionTime : endEpoch;
+            uint64_t stepMs = (int64_t)next * 1000 > nowMs ? (uint64_t)((int64_t)next * 1000 - nowMs) : 1000;
+            uint64_t upMs = MonotonicClock::nowMs();
+            if (!scheduledWake && upMs < DeepSleep::AWAKE_AFTER_BOOT_MS && DeepSleep::AWAKE_AFTER_BOOT_MS - upMs < stepMs) {
+                stepMs = DeepSleep::AWAKE_AFTER_BOOT_MS - upMs;
+            }
+            MonotonicClock::advance(stepMs);
+        }
+        awakeMs += MonotonicClock::nowMs();
+        delete task;
+        delete sim;
+        scheduledWake = true;
+    }
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) {
+        if ((lastMask >> z) & 1) result.zoneOnMinutes[z] += (uint32_t)((endEpoch - lastChange) / 60);
+    }
+    result.wallMicros = micros() - start;
+    result.awakeSeconds = (uint32_t)(awakeMs / 1000);
+    result.maxWakeToRelayMs = sleeper.record().maxWakeToRelayMs;
+    result.maxRelayLateMs = sleeper.record().maxRelayLateMs;
+
+    WallClock::useSystem();
+    if (wasManual) {
+        MonotonicClock::setManual(manualMs);
+    } else {
+        MonotonicClock::useSystem();
+    }
+    return result;
+}
+
+String deepSleepSimToJson(const DeepSleepSimResult& result, const String& traceJson) {
+    String json = "{";
+    json += "\"startEpoch\":" + String((long)result.startEpoch);
+    json += ",\"days\":" + String(result.days);
+    json += ",\"sleeps\":" + String(result.sleeps);
+    json += ",\"scheduledWakes\":" + String(result.scheduledWakes);
+    json += ",\"transitions\":" + String(result.transitions);
+    json += ",\"awakeSeconds\":" + String(result.awakeSeconds);
+    json += ",\"awakePercent\":" + String(result.days ? result.awakeSeconds / (result.days * 864.0f) : 0.0f, 3);
+    json += ",\"maxWakeToRelayMs\":" + String(result.maxWakeToRelayMs);
+    json += ",\"maxRelayLateMs\":" + String((long)result.maxRelayLateMs);
+    json += ",\"wallMicros\":" + String(result.wallMicros);
+    json += ",\"zoneOnMinutes\":[";
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) {
+        json += String(result.zoneOnMinutes[z]);
+        if (z < YEAR_SIM_ZONES - 1) json += ",";
+    }
+    json += "]";
+    if (traceJson.length() > 0) json += ",\"trace\":" + traceJson;
+    json += "}";
+    return json;
+}
@@ -0,0 +1,162 @@
+#ifndef SCHEDULE_BENCH_H
+#define SCHEDULE_BENCH_H
+
+#include <Arduino.h>
+#include "schedule.h"
+
+// Result of one schedule tick benchmark run (all times in microseconds)
+struct ScheduleBenchResult {
+    uint32_t ticks;            // Number of simulated schedule ticks
+    uint32_t legacyMicros;     // String substring().toInt() evaluation (pre-table)
+    uint32_t tableMicros;      // Binary search in the sorted ScheduleTable
+    uint32_t bitmapMicros;     // Minute-of-week occupancy bitmap bit test
+    uint32_t legacyOnCount;    // Zones found ON by the legacy path (sanity check)
+    uint32_t tableOnCount;     // Zones found ON by the table path (matches legacy except runs wrapping midnight)
+    uint32_t bitmapOnCount;    // Zones found ON by the bitmap (also counts runs carried over midnight)
+};
+
+/**
+ * @brief Measures the per-tick cost of evaluating today's schedules for every zone.
+ *
+ * Runs the same ticks through the old String-based "HH:mm" parsing, the sorted
+ * ScheduleTable lookup and the occupancy bitmap, sweeping across the day.
+ * @param scheduleManager Schedule manager whose calculated schedules are evaluated
+ * @param ticks Number of ticks to simulate
+ */
+ScheduleBenchResult runScheduleTickBenchmark(ScheduleManager& scheduleManager, uint32_t ticks);
+
+// Serialize a benchmark result as JSON for the /bench/schedule endpoint
+String scheduleBenchToJson(const ScheduleBenchResult& result);
+
+// Cost of the schedule engine at the compiled NUM_PROGRAMS x MAX_ZONES size
+struct ScheduleComputeBenchResult {
+    int programs;                          // NUM_PROGRAMS
+    int zones;                             // MAX_ZONES
+    uint32_t iterations;                   // Computations timed per measurement
+    uint32_t dailyMicros[NUM_PROGRAMS];    // calculateZoneSchedules() total with p+1 programs enabled
+    uint32_t weeklyIndexMicros;            // rebuildOccupancyIndex() total with all programs enabled
+    uint32_t programChangeMicros;          // recalculatePrograms() total for one changed program
+    uint32_t managerBytes;                 // RAM of one ScheduleManager with MAX_ZONES zones (ScheduleManager::footprintBytes())
+    uint32_t tableBytes;                   // RAM of one ScheduleTable (a manager holds two)
+    uint32_t freeHeapBytes;                // Free heap before the scratch manager
+    bool ran;                              // False if the scratch manager did not fit: footprint only
+};
+
+/**
+ * @brief Times the schedule engine on a synthetic worst case.
+ *
+ * Uses a scratch ScheduleManager with MAX_ZONES zones, every program
+ * enabled on every day and all MAX_START_TIMES start times in use. The
+ * scratch manager is a second copy next to the live one, so the timings are
+ * skipped (and only the footprint reported) when the heap cannot hold it.
+ * At -DNUM_PROGRAMS=16 -DMAX_ZONES=32 the worst-case tables alone do not fit
+ * in ESP32 RAM; cap them with -DSCHEDULE_TABLE_CAPACITY (or lower
+ * MAX_CYCLES_PER_ZONE) to get the 16 programs x 32 zones figure.
+ * @param iterations Number of computations per measurement
+ */
+ScheduleComputeBenchResult runScheduleComputeBenchmark(uint32_t iterations);
+
+// Serialize a compute benchmark result as JSON for the /bench/compute endpoint
+String scheduleComputeBenchToJson(const ScheduleComputeBenchResult& result);
+
+// Cost of the control pass run arbitration (all times in microseconds)
+struct RunTickBenchResult {
+    uint32_t ticks;            // Number of simulated control passes
+    uint32_t segments;         // Segments of the Run Program Now under test
+    uint32_t arbiterMicros;    // advance() + zoneMask() + nextTransition() total
+    uint32_t maskChanges;      // Times the zones to open changed (sanity check)
+};
+
+/**
+ * @brief Times RunArbiter on a synthetic worst case.
+ *
+ * Every source is active: a Run Program Now with MAX_SEGMENTS one-minute
+ * segments, a Quick Run over every zone (paused behind it), manual and
+ * schedule zone masks. The ticks sweep both timed runs from start to end.
+ * @param ticks Number of control passes to simulate
+ */
+RunTickBenchResult runRunTickBenchmark(uint32_t ticks);
+
+// Serialize a run arbitration benchmark result as JSON for the /bench/run_tick endpoint
+String runTickBenchToJson(const RunTickBenchResult& result);
+
+// Zones and programs of the year simulation
+#define YEAR_SIM_ZONES 8
+#define YEAR_SIM_PROGRAMS 3
+// Longest runs the /bench/year and /bench/deep_sleep handlers accept: a run blocks
+// loop() (web server, OTA) until it returns. Both caps cost about the same, since a
+// deep-sleep day (a fresh boot per wake) costs about five year-simulation days
+#define YEAR_SIM_MAX_DAYS 366
+#define DEEP_SLEEP_SIM_MAX_DAYS 62
+
+// One relay change in the year simulation trace
+struct YearSimTransition {
+    time_t at;                 // Simulated epoch time of the change
+    uint32_t zoneMask;         // Relays on from then on (bit z = zone z)
+};
+
+// Outcome of a fast-forward year simulation
+struct YearSimResult {
+    time_t startEpoch;         // Simulated start (local midnight of a day)
+    uint32_t days;             // Simulated calendar days
+    uint32_t passes;           // Control passes stepped
+    uint32_t transitions;      // Applied relay mask changes
+    uint32_t wallMicros;       // Real time the simulation took
+    uint32_t zoneOnMinutes[YEAR_SIM_ZONES]; // Simulated time each relay was on
+};
+
+typedef void (*YearSimTraceCallback)(const YearSimTransition& transition, void* context);
+
+/**
+ * @brief Runs the control logic over a simulated calendar, as fast as it goes.
+ *
+ * A private ScheduleManager with YEAR_SIM_PROGRAMS synthetic programs
+ * (weekday, every-N-days and odd-day recurrences, a run across midnight and a
+ * seasonal monthly budget) over YEAR_SIM_ZONES zones is driven by a
+ * Simulation-mode ControlTask. WallClock and MonotonicClock are switched to
+ * simulated time on the calling thread and jump from one schedule transition
+ * to the next instead of stepping through every minute.
+ * The live controller, its clocks and its log are not touched.
+ * @param days Calendar days to simulate
+ * @param startEpoch Simulated start time (must be a valid clock, see isClockValid())
+ * @param trace Called for every relay change (optional)
+ * @param context Passed to trace
+ */
+YearSimResult runYearSimulation(uint32_t days, time_t startEpoch,
+                                YearSimTraceCallback trace = nullptr, void* context = nullptr);
+
+// Serialize a year simulation result as JSON for the /bench/year endpoint; traceJson is
+// a JSON array of transitions (or empty)
+String yearSimToJson(const YearSimResult& result, const String& traceJson);
+
+// Outcome of the deep-sleep simulation (same programs and zones as the year simulation)
+struct DeepSleepSimResult {
+    time_t startEpoch;
+    uint32_t days;
+    uint32_t sleeps;           // Deep sleeps
+    uint32_t scheduledWakes;   // Sleeps that ended at WAKE_LEAD_S before a program start
+    uint32_t transitions;      // Applied relay mask changes
+    uint32_t awakeSeconds;     // Simulated time awake, boots included
+    uint32_t maxWakeToRelayMs; // Wake to the first relay on, worst scheduled wake
+    int32_t maxRelayLateMs;    // First relay on vs the program start, worst scheduled wake
+    uint32_t wallMicros;       // Real time the simulation took
+    uint32_t zoneOnMinutes[YEAR_SIM_ZONES];
+};
+
+/**
+ * @brief Runs the year simulation's programs with deep sleep between waterings.
+ *
+ * Each wake is a fresh boot: a new ScheduleManager and Simulation-mode
+ * ControlTask (RAM does not survive deep sleep), the clock carried on from
+ * the sleep, and a DeepSleep object standing in for the RTC record. The
+ * first boot is a power-on and stays up for DeepSleep::AWAKE_AFTER_BOOT_MS;
+ * after that the controller only wakes for program starts (or to re-plan).
+ * On-time per zone should match runYearSimulation() over the same days.
+ */
+DeepSleepSimResult runDeepSleepSimulation(uint32_t days, time_t startEpoch,
+                                          YearSimTraceCallback trace = nullptr, void* context = nullptr);
+
+// Serialize a deep-sleep simulation result as JSON for the /bench/deep_sleep endpoint
+String deepSleepSimToJson(const DeepSleepSimResult& result, const String& traceJson);
+
+#endif // SCHEDULE_BENCH_H
@@ -0,0 +1,50 @@
+#ifndef SCHEDULE_LIMITS_H
+#define SCHEDULE_LIMITS_H
+
+// Compile-time sizing for the schedule engine. Override any of these with -D build flags.
+
+// Number of irrigation programs (A, B, C, ...). Override with -DNUM_PROGRAMS=16.
+#ifndef NUM_PROGRAMS
+#define NUM_PROGRAMS 3
+#endif
+
+// Maximum zones a program can hold durations for. Override with -DMAX_ZONES=32.
+#ifndef MAX_ZONES
+#define MAX_ZONES 8
+#endif
+
+// Start times per program per day
+#ifndef MAX_START_TIMES
+#define MAX_START_TIMES 4
+#endif
+
+// Cycles a zone's run can be split into by cycle-and-soak
+#ifndef MAX_CYCLES_PER_ZONE
+#define MAX_CYCLES_PER_ZONE 4
+#endif
+
+// Intervals a schedule table holds (yesterday and today). The default fits the worst case,
+// every start of every program with every zone split into MAX_CYCLES_PER_ZONE cycles; at
+// large sizes that no longer fits in ESP32 RAM, so cap it with -DSCHEDULE_TABLE_CAPACITY=n
+// (runs past the cap are dropped and counted, see ScheduleTable::dropped())
+#ifndef SCHEDULE_TABLE_CAPACITY
+#define SCHEDULE_TABLE_CAPACITY (2 * NUM_PROGRAMS * MAX_START_TIMES * MAX_ZONES * MAX_CYCLES_PER_ZONE)
+#endif
+
+#if NUM_PROGRAMS < 1 || NUM_PROGRAMS > 26
+#error "NUM_PROGRAMS must be between 1 and 26 (programs are named A-Z)"
+#endif
+#if MAX_ZONES < 1 || MAX_ZONES > 32
+#error "MAX_ZONES must be between 1 and 32"
+#endif
+#if MAX_START_TIMES < 1 || MAX_START_TIMES > 8
+#error "MAX_START_TIMES must be between 1 and 8"
+#endif
+#if MAX_CYCLES_PER_ZONE < 1 || MAX_CYCLES_PER_ZONE > 8
+#error "MAX_CYCLES_PER_ZONE must be between 1 and 8"
+#endif
+#if SCHEDULE_TABLE_CAPACITY < 1 || SCHEDULE_TABLE_CAPACITY > 65535
+#error "SCHEDULE_TABLE_CAPACITY must be between 1 and 65535 (cap it at large NUM_PROGRAMS x MAX_ZONES sizes)"
+#endif
+
+#endif // SCHEDULE_LIMITS_H
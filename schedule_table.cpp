@@ -0,0 +1,119 @@
+/**
+ * @file schedule_table.cpp
+ * @brief Sorted per-zone interval table with O(log n) "is on" lookups.
+ */
+
+#include "schedule_table.h"
+
+ScheduleTable::ScheduleTable() {
+    clear();
+}
+
+void ScheduleTable::clear() {
+    _count = 0;
+    _dropped = 0;
+    for (int z = 0; z <= MAX_ZONES; z++) _zoneStart[z] = 0;
+}
+
+bool ScheduleTable::add(int zone, int startMinute, int endMinute, int programIndex, int startIndex) {
+    if (zone < 0 || zone >= MAX_ZONES || endMinute <= startMinute) return false;
+    if (_count >= CAPACITY) {
+        if (_dropped < 0xFFFF) _dropped++;
+        return false;
+    }
+    if (endMinute > 0xFFFF) endMinute = 0xFFFF;
+    ZoneInterval& entry = _entries[_count];
+    entry.startMinute = startMinute;
+    entry.endMinute = endMinute;
+    entry.coverEnd = endMinute;
+    entry.programIndex = programIndex;
+    entry.startIndex = startIndex;
+    _zones[_count] = zone;
+    _count++;
+    return true;
+}
+
+void ScheduleTable::finalize(ZoneInterval* scratch) {
+    // Counting sort by zone into the caller's scratch storage (stable, O(n))
+    uint16_t next[MAX_ZONES + 1] = {0};
+    for (int i = 0; i < _count; i++) next[_zones[i] + 1]++;
+    for (int z = 0; z < MAX_ZONES; z++) next[z + 1] += next[z];
+    for (int z = 0; z <= MAX_ZONES; z++) _zoneStart[z] = next[z];
+    for (int i = 0; i < _count; i++) scratch[next[_zones[i]]++] = _entries[i];
+
+    for (int z = 0; z < MAX_ZONES; z++) {
+        int begin = _zoneStart[z];
+        int end = _zoneStart[z + 1];
+        // Insertion sort by start: each program's starts arrive in order, so runs are nearly sorted
+        for (int i = begin; i < end; i++) {
+            ZoneInterval key = scratch[i];
+            int j = i - 1;
+            while (j >= begin && _entries[j].startMinute > key.startMinute) {
+                _entries[j + 1] = _entries[j];
+                j--;
+            }
+            _entries[j + 1] = key;
+            _zones[i] = z;
+        }
+        // Running max end, so a lookup can reject a minute without scanning back
+        uint16_t cover = 0;
+        for (int i = begin; i < end; i++) {
+            if (_entries[i].endMinute > cover) cover = _entries[i].endMinute;
+            _entries[i].coverEnd = cover;
+        }
+    }
+}
+
+void ScheduleTable::rebaseFrom(const ScheduleTable& source, int minutes, uint32_t dropPrograms) {
+    int kept = 0;
+    for (int i = 0; i < source._count; i++) {
+        if (source._entries[i].endMinute <= minutes) continue;
+        if ((dropPrograms >> source._entries[i].programIndex) & 1) continue;
+        ZoneInterval entry = source._entries[i];
+        entry.startMinute = entry.startMinute > minutes ? entry.startMinute - minutes : 0;
+        entry.endMinute -= minutes;
+        _entries[kept] = entry;
+        _zones[kept] = source._zones[i];
+        kept++;
+    }
+    _count = kept;
+    _dropped = 0;
+}
+
+int ScheduleTable::zoneIntervalCount(int zone) const {
+    if (zone < 0 || zone >= MAX_ZONES) return 0;
+    return _zoneStart[zone + 1] - _zoneStart[zone];
+}
+
+const ZoneInterval* ScheduleTable::zoneIntervals(int zone) const {
+    if (zone < 0 || zone >= MAX_ZONES) return _entries;
+    return _entries + _zoneStart[zone];
+}
+
+int ScheduleTable::findInterval(int zone, int minute) const {
+    int n = zoneIntervalCount(zone);
+    if (n == 0) return -1;
+    const ZoneInterval* intervals = zoneIntervals(zone);
+    // Binary search for the last interval starting at or before minute
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (intervals[mid].startMinute <= minute) lo = mid + 1;
+        else hi = mid;
+    }
+    int i = lo - 1;
+    if (i < 0 || intervals[i].coverEnd <= minute) return -1;
+    // Covered: walk back to the interval that actually spans minute (usually i itself)
+    while (intervals[i].endMinute <= minute) i--;
+    return i;
+}
+
+int ScheduleTable::nextBoundary(int minute) const {
+    int next = -1;
+    for (int i = 0; i < _count; i++) {
+        const ZoneInterval& entry = _entries[i];
+        int boundary = entry.startMinute > minute ? entry.startMinute : entry.endMinute;
+        if (boundary > minute && (next < 0 || boundary < next)) next = boundary;
+    }
+    return next;
+}
@@ -0,0 +1,63 @@
+#ifndef SCHEDULE_TABLE_H
+#define SCHEDULE_TABLE_H
+
+#include <stdint.h>
+#include "schedule_limits.h"
+
+// One watering interval for a zone, in minutes from the start of the table's horizon
+struct ZoneInterval {
+    uint16_t startMinute;     // Start, minutes from the horizon start
+    uint16_t endMinute;       // Exclusive end; may run past the end of the horizon
+    uint16_t coverEnd;        // Max endMinute over this and all earlier intervals of the zone
+    uint8_t programIndex;     // Program that produced this interval (0 = A)
+    uint8_t startIndex;       // Which of the program's start times produced it
+};
+
+/**
+ * @brief Per-zone sorted interval table over a multi-day horizon.
+ *
+ * Intervals are appended unsorted with add(), then finalize() groups them by
+ * zone, sorts each zone by start minute and fills coverEnd so that "is zone z
+ * on at minute m" is a binary search: O(log n) in that zone's interval count.
+ * rebaseFrom() slides another table's horizon forward, keeping runs that are
+ * still active, so a new day can be appended without rebuilding the ones
+ * before it.
+ * Storage is fixed-size (CAPACITY intervals); nothing is allocated after construction.
+ */
+class ScheduleTable {
+public:
+    static const int HORIZON_DAYS = 2;
+    static const int CAPACITY = SCHEDULE_TABLE_CAPACITY;  // HORIZON_DAYS of worst-case runs unless capped
+
+    ScheduleTable();
+    void clear();
+    // Append an interval; returns false if the table is full (counted in dropped())
+    bool add(int zone, int startMinute, int endMinute, int programIndex, int startIndex);
+    // Sort by zone and start time and build the lookup index; call after the last add().
+    // scratch holds CAPACITY entries and belongs to the caller, so tables of different
+    // owners (the live schedule, a simulation) can be finalized at the same time
+    void finalize(ZoneInterval* scratch);
+    // Replace the contents with source's intervals moved forward by minutes: drops intervals
+    // that ended before the new start and shifts the rest back (source may be this table).
+    // Intervals of programs in dropPrograms (bit p = program p) are left out as well.
+    // Call add() for the new span, then finalize().
+    void rebaseFrom(const ScheduleTable& source, int minutes, uint32_t dropPrograms = 0);
+
+    int size() const { return _count; }
+    int dropped() const { return _dropped; }  // Intervals refused because the table was full
+    int zoneIntervalCount(int zone) const;
+    const ZoneInterval* zoneIntervals(int zone) const;
+    // Index (within the zone) of an interval covering minute, or -1 if the zone is off
+    int findInterval(int zone, int minute) const;
+    bool isOn(int zone, int minute) const { return findInterval(zone, minute) >= 0; }
+    // First interval start or end after minute in any zone, or -1 if there is none
+    int nextBoundary(int minute) const;
+private:
+    ZoneInterval _entries[CAPACITY];
+    uint8_t _zones[CAPACITY];            // Zone of each appended entry until finalize()
+    uint16_t _zoneStart[MAX_ZONES + 1];  // Entries of zone z are [_zoneStart[z], _zoneStart[z + 1])
+    uint16_t _count;
+    uint16_t _dropped;
+};
+
+#endif // SCHEDULE_TABLE_H
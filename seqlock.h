@@ -0,0 +1,64 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Single-writer sequence lock for publishing a small trivially copyable value.
+ *
+ * The writer never waits: it makes the sequence odd, stores the value and makes
+ * it even again. Readers copy the value and retry if the sequence was odd or
+ * moved during the copy, so they never block the writer and never see a torn
+ * value. The value is kept as relaxed atomic words, which keeps concurrent
+ * reads well defined.
+ */
+template <typename T>
+class SeqLock {
+public:
+    SeqLock() : _sequence(0) {
+        for (int i = 0; i < WORDS; i++) _words[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Publish a new value (one writer at a time)
+    void write(const T& value) {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+        uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < WORDS; i++) _words[i].store(words[i], std::memory_order_relaxed);
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Copy out a consistent value; false if a write was in progress
+    bool tryRead(T& value) const {
+        uint32_t before = _sequence.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        uint32_t words[WORDS];
+        for (int i = 0; i < WORDS; i++) words[i] = _words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) != before) return false;
+        memcpy(&value, words, sizeof(T));
+        return true;
+    }
+
+    // Copy out a consistent value, retrying while a write is in progress
+    T read() const {
+        T value;
+        while (!tryRead(value)) {
+        }
+        return value;
+    }
+
+    // Number of completed writes
+    uint32_t writes() const { return _sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static const int WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    std::atomic<uint32_t> _sequence;
+    std::atomic<uint32_t> _words[WORDS];
+};
+
+#endif // SEQLOCK_H
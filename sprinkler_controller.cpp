@@ -1,21 +1,66 @@
 #include "sprinkler_controller.h"
 
+#include <driver/gpio.h>
+#include <soc/gpio_reg.h>
+
 SprinklerController::SprinklerController(const int* pins, const bool* activeLow, int count, int statusLedPin)
     : _pins(pins), _activeLow(activeLow), _count(count), _statusLedPin(statusLedPin) {}
 
 void SprinklerController::begin() {
+    if (!_pins) return;
     for (int i = 0; i < _count; ++i) {
         pinMode(_pins[i], OUTPUT);
         // Default all relays OFF
         setRelay(i, false);
     }
-    pinMode(_statusLedPin, OUTPUT);
+    holdOutputs(false); // Held through deep sleep: the OFF levels just written take over
+    if (_statusLedPin >= 0) pinMode(_statusLedPin, OUTPUT);
     setStatusLed(false);
 }
 
 void SprinklerController::setRelay(int zone, bool on) {
     if (zone < 0 || zone >= _count) return;
-    digitalWrite(_pins[zone], _activeLow[zone] ? !on : on);
+    if (_pins) {
+        digitalWrite(_pins[zone], _activeLow[zone] ? !on : on);
+        _physicalWrites++;
+    }
+    if (on) {
+        _appliedMask |= 1UL << zone;
+    } else {
+        _appliedMask &= ~(1UL << zone);
+    }
+}
+
+void SprinklerController::applyZoneMask(uint32_t zoneMask) {
+    if (_count < 32) zoneMask &= (1UL << _count) - 1;
+    uint32_t changed = zoneMask ^ _appliedMask;
+    if (changed == 0) return;
+    if (!_pins) {
+        _appliedMask = zoneMask;
+        return;
+    }
+    // Output levels of the changed zones, per GPIO bank (pins 0-31 and 32-39)
+    uint32_t set[2] = {0, 0};
+    uint32_t clear[2] = {0, 0};
+    for (int zone = 0; zone < _count; ++zone) {
+        if (!((changed >> zone) & 1)) continue;
+        bool on = (zoneMask >> zone) & 1;
+        bool high = _activeLow[zone] ? !on : on;
+        int bank = _pins[zone] / 32;
+        uint32_t bit = 1UL << (_pins[zone] % 32);
+        if (high) {
+            set[bank] |= bit;
+        } else {
+            clear[bank] |= bit;
+        }
+    }
+    if (set[0]) { REG_WRITE(GPIO_OUT_W1TS_REG, set[0]); _physicalWrites++; }
+    if (clear[0]) { REG_WRITE(GPIO_OUT_W1TC_REG, clear[0]); _physicalWrites++; }
+#ifdef GPIO_OUT1_W1TS_REG
+    if (set[1]) { REG_WRITE(GPIO_OUT1_W1TS_REG, set[1]); _physicalWrites++; }
+    if (clear[1]) { REG_WRITE(GPIO_OUT1_W1TC_REG, clear[1]); _physicalWrites++; }
+#endif
+    _appliedMask = zoneMask;
 }
 
 void SprinklerController::setAllOff() {
@@ -24,7 +69,24 @@ void SprinklerController::setAllOff() {
     }
 }
 
+void SprinklerController::holdOutputs(bool hold) {
+    if (!_pins) return;
+    for (int zone = 0; zone < _count; ++zone) {
+        if (hold) {
+            gpio_hold_en((gpio_num_t)_pins[zone]);
+        } else {
+            gpio_hold_dis((gpio_num_t)_pins[zone]);
+        }
+    }
+    if (hold) {
+        gpio_deep_sleep_hold_en();
+    } else {
+        gpio_deep_sleep_hold_dis();
+    }
+}
+
 void SprinklerController::setStatusLed(bool on) {
+    if (_statusLedPin < 0) return;
     digitalWrite(_statusLedPin, on ? LOW : HIGH); // Assuming active-low LED
 }
 
@@ -33,11 +95,11 @@ int SprinklerController::getZoneCount() const {
 }
 
 int SprinklerController::getPin(int zone) const {
-    if (zone < 0 || zone >= _count) return -1;
+    if (zone < 0 || zone >= _count || !_pins) return -1;
     return _pins[zone];
 }
 
 bool SprinklerController::isActiveLow(int zone) const {
-    if (zone < 0 || zone >= _count) return false;
+    if (zone < 0 || zone >= _count || !_activeLow) return false;
     return _activeLow[zone];
 }
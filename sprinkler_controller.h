@@ -5,11 +5,22 @@
 
 class SprinklerController {
 public:
-    // Constructor takes arrays for pin mapping and active logic
+    // Constructor takes arrays for pin mapping and active logic. Without pins
+    // (nullptr, for simulations) only the applied mask is tracked; a negative
+    // statusLedPin means no LED.
     SprinklerController(const int* pins, const bool* activeLow, int count, int statusLedPin);
     void begin();
     void setRelay(int zone, bool on);
+    // Switch every zone to the bits of zoneMask (bit z = zone z on). Only zones
+    // that differ from the last applied mask are written, all in one GPIO
+    // set/clear register write per bank.
+    void applyZoneMask(uint32_t zoneMask);
+    uint32_t appliedZoneMask() const { return _appliedMask; }
+    uint32_t physicalWrites() const { return _physicalWrites; } // Pin or GPIO register writes issued
     void setAllOff();
+    // Latch the relay pins at their current levels through deep sleep and the next boot
+    // (ESP32 GPIO hold); begin() releases them once it has driven them off again
+    void holdOutputs(bool hold);
     void setStatusLed(bool on);
     int getZoneCount() const;
     int getPin(int zone) const;
@@ -19,6 +30,8 @@ private:
     const bool* _activeLow;
     int _count;
     int _statusLedPin;
+    uint32_t _appliedMask = 0;
+    uint32_t _physicalWrites = 0;
 };
 
 #endif // SPRINKLER_CONTROLLER_H
@@ -0,0 +1,41 @@
+// Host run of the on-device benchmarks and simulations (the /bench/... endpoints), printed as
+// the same JSON. Build sizes follow DEFS, e.g. make bench DEFS="-DNUM_PROGRAMS=16 -DMAX_ZONES=32"
+#include "schedule_bench.h"
+#include "sprinkler_controller.h"
+
+static void print(const char* name, const String& json) { printf("%s %s\n", name, json.c_str()); }
+
+int main() {
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+    const time_t start = 1735686000;  // 2025-01-01 00:00 CET
+
+    // Tick evaluation: two programs on 8 zones, one carried over midnight
+    {
+        const int zones = MAX_ZONES < 8 ? MAX_ZONES : 8;
+        SprinklerController controller(nullptr, nullptr, zones, -1);
+        ScheduleManager scheduleManager(zones, &controller);
+        scheduleManager.initializePrograms();
+        Program& night = scheduleManager.programs[0];
+        night.enabled = true;
+        night.startTimes[0] = 23 * 60 + 30;
+        for (int d = 0; d < 7; d++) night.daysOfWeek[d] = true;
+        for (int z = 0; z < zones; z++) night.durations[z] = 10;
+        if (NUM_PROGRAMS > 1) {
+            Program& morning = scheduleManager.programs[1];
+            morning.enabled = true;
+            morning.startTimes[0] = 6 * 60;
+            morning.daysOfWeek[2] = true;
+            morning.durations[zones - 1] = 15;
+        }
+        scheduleManager.setScheduleDate(epochDayFromTm(*localtime(&start)));
+        scheduleManager.rebuildOccupancyIndex();
+        scheduleManager.calculateZoneSchedules(2);
+        print("/bench/schedule", scheduleBenchToJson(runScheduleTickBenchmark(scheduleManager, 14400)));
+    }
+    print("/bench/compute", scheduleComputeBenchToJson(runScheduleComputeBenchmark(100)));
+    print("/bench/run_tick", runTickBenchToJson(runRunTickBenchmark(100000)));
+    print("/bench/year", yearSimToJson(runYearSimulation(365, start), String()));
+    print("/bench/deep_sleep", deepSleepSimToJson(runDeepSleepSimulation(365, start), String()));
+    return 0;
+}
@@ -0,0 +1,16 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Minimal checks for the host tests: a failed CHECK reports the line and ends the test
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            exit(1);                                                                  \
+        }                                                                             \
+    } while (0)
+
+#endif // HOST_TEST_H
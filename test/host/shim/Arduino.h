@@ -0,0 +1,133 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the Arduino core: the parts of String, GPIO, timing, Serial
+// and ESP the control logic uses. GPIO levels are kept in memory (digitalRead()
+// returns the last write) so tests can check the relays.
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+class String {
+public:
+    String() {}
+    String(const char* text) : _text(text ? text : "") {}
+    String(const std::string& text) : _text(text) {}
+    explicit String(char c) : _text(1, c) {}
+    String(int value) : _text(std::to_string(value)) {}
+    String(unsigned value) : _text(std::to_string(value)) {}
+    String(long value) : _text(std::to_string(value)) {}
+    String(unsigned long value) : _text(std::to_string(value)) {}
+    String(long long value) : _text(std::to_string(value)) {}
+    String(unsigned long long value) : _text(std::to_string(value)) {}
+    String(double value, int decimals = 2) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.*f", decimals, value);
+        _text = text;
+    }
+
+    unsigned length() const { return _text.size(); }
+    const char* c_str() const { return _text.c_str(); }
+    bool reserve(unsigned size) { _text.reserve(size); return true; }
+    String substring(unsigned from) const { return from < _text.size() ? String(_text.substr(from)) : String(); }
+    String substring(unsigned from, unsigned to) const {
+        return from < _text.size() && to > from ? String(_text.substr(from, to - from)) : String();
+    }
+    int indexOf(char c, unsigned from = 0) const { return find(_text.find(c, from)); }
+    int indexOf(const String& text, unsigned from = 0) const { return find(_text.find(text._text, from)); }
+    bool startsWith(const String& prefix) const { return _text.rfind(prefix._text, 0) == 0; }
+    char charAt(unsigned i) const { return i < _text.size() ? _text[i] : 0; }
+    char operator[](unsigned i) const { return charAt(i); }
+    long toInt() const { return atol(_text.c_str()); }
+    float toFloat() const { return atof(_text.c_str()); }
+    void toUpperCase() { for (char& c : _text) c = toupper(c); }
+    void trim() {
+        size_t first = _text.find_first_not_of(" \t\r\n");
+        size_t last = _text.find_last_not_of(" \t\r\n");
+        _text = first == std::string::npos ? std::string() : _text.substr(first, last - first + 1);
+    }
+    bool isEmpty() const { return _text.empty(); }
+
+    bool concat(const String& text) { _text += text._text; return true; }
+    String& operator+=(const String& text) { _text += text._text; return *this; }
+    String& operator+=(const char* text) { _text += text; return *this; }
+    String& operator+=(char c) { _text += c; return *this; }
+    bool operator==(const String& other) const { return _text == other._text; }
+    bool operator==(const char* other) const { return _text == other; }
+    bool operator!=(const String& other) const { return _text != other._text; }
+    bool operator!=(const char* other) const { return _text != other; }
+
+private:
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    std::string _text;
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s += b; return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, char b) { String s(a); s += b; return s; }
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned us);
+void yield();
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int level);
+int digitalRead(int pin);
+// Host only: digitalWrite() calls since start, to count relay writes
+unsigned long hostDigitalWrites();
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    void flush() { fflush(stdout); }
+    int availableForWrite() { return 128; }
+    int available() { return 0; }
+    int read() { return -1; }
+    String readStringUntil(char) { return String(); }
+    size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* data, size_t size) { return fwrite(data, 1, size, stdout); }
+    size_t print(const String& text) { return fputs(text.c_str(), stdout); }
+    size_t print(const char* text) { return fputs(text, stdout); }
+    size_t println(const String& text = String()) { return puts(text.c_str()); }
+    size_t println(const char* text) { return puts(text); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+};
+extern HardwareSerial Serial;
+
+// A 240 MHz part with a cycle counter derived from micros(). The heap is the
+// host's, so /bench/compute's scratch manager always fits, at any build size.
+class EspClass {
+public:
+    void restart() { exit(0); }
+    uint32_t getFreeHeap() { return 64UL << 20; }
+    uint32_t getMaxAllocHeap() { return 64UL << 20; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getCycleCount() { return (uint32_t)(micros() * 240); }
+};
+extern EspClass ESP;
+
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+void configTzTime(const char* tz, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+
+#endif // HOST_ARDUINO_H
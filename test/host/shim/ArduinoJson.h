@@ -0,0 +1,53 @@
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+// Host stand-in for ArduinoJson: documents accept writes and read back as
+// missing. Preferences stores nothing on the host, so nothing is parsed.
+#include <Arduino.h>
+
+#define JSON_ARRAY_SIZE(n) ((n) * 16)
+#define JSON_OBJECT_SIZE(n) ((n) * 16)
+
+struct JsonObject;
+
+struct JsonVariant {
+    template <typename T> JsonVariant operator=(const T&) { return *this; }
+    JsonVariant operator[](int) const { return JsonVariant(); }
+    JsonVariant operator[](const char*) const { return JsonVariant(); }
+    template <typename T> T operator|(const T& value) const { return value; }
+    template <typename T> T as() const { return T(); }
+    template <typename T> operator T() const { return T(); }
+    bool isNull() const { return true; }
+};
+
+struct JsonArray {
+    template <typename T> bool add(const T&) { return true; }
+    JsonObject createNestedObject();
+    JsonVariant operator[](int) const { return JsonVariant(); }
+    size_t size() const { return 0; }
+};
+
+struct JsonObject {
+    JsonVariant operator[](const char*) const { return JsonVariant(); }
+    JsonArray createNestedArray(const char*) { return JsonArray(); }
+};
+
+inline JsonObject JsonArray::createNestedObject() { return JsonObject(); }
+
+class DynamicJsonDocument {
+public:
+    explicit DynamicJsonDocument(size_t) {}
+    JsonVariant operator[](const char*) const { return JsonVariant(); }
+    JsonArray createNestedArray(const char*) { return JsonArray(); }
+    JsonObject createNestedObject(const char*) { return JsonObject(); }
+};
+
+struct DeserializationError {
+    explicit operator bool() const { return true; }
+    const char* c_str() const { return "not parsed on the host"; }
+};
+
+inline DeserializationError deserializeJson(DynamicJsonDocument&, const String&) { return DeserializationError(); }
+inline size_t serializeJson(const DynamicJsonDocument&, String&) { return 0; }
+
+#endif // HOST_ARDUINOJSON_H
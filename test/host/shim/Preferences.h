@@ -0,0 +1,34 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// Host stand-in for NVS Preferences: nothing is stored, every read returns its default
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char*, bool = false) { return true; }
+    void end() {}
+    bool clear() { return true; }
+    bool remove(const char*) { return true; }
+    bool isKey(const char*) { return false; }
+
+    String getString(const char*, const String& value = String()) { return value; }
+    size_t putString(const char*, const String&) { return 0; }
+    bool getBool(const char*, bool value = false) { return value; }
+    size_t putBool(const char*, bool) { return 0; }
+    uint8_t getUChar(const char*, uint8_t value = 0) { return value; }
+    size_t putUChar(const char*, uint8_t) { return 0; }
+    uint16_t getUShort(const char*, uint16_t value = 0) { return value; }
+    size_t putUShort(const char*, uint16_t) { return 0; }
+    int32_t getInt(const char*, int32_t value = 0) { return value; }
+    size_t putInt(const char*, int32_t) { return 0; }
+    uint32_t getUInt(const char*, uint32_t value = 0) { return value; }
+    size_t putUInt(const char*, uint32_t) { return 0; }
+    uint64_t getULong64(const char*, uint64_t value = 0) { return value; }
+    size_t putULong64(const char*, uint64_t) { return 0; }
+    size_t getBytesLength(const char*) { return 0; }
+    size_t getBytes(const char*, void*, size_t) { return 0; }
+    size_t putBytes(const char*, const void*, size_t) { return 0; }
+};
+
+#endif // HOST_PREFERENCES_H
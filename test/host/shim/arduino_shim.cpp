@@ -0,0 +1,46 @@
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+static std::atomic<int> pinLevels[64];
+static std::atomic<unsigned long> digitalWrites(0);
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(unsigned us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield() { std::this_thread::yield(); }
+
+void pinMode(int, int) {}
+
+void digitalWrite(int pin, int level) {
+    if (pin < 0 || pin >= 64) return;
+    pinLevels[pin].store(level);
+    digitalWrites++;
+}
+
+int digitalRead(int pin) { return pin >= 0 && pin < 64 ? pinLevels[pin].load() : LOW; }
+
+unsigned long hostDigitalWrites() { return digitalWrites.load(); }
+
+bool getLocalTime(struct tm* info, uint32_t) {
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return true;
+}
+
+void configTzTime(const char* tz, const char*, const char*, const char*) {
+    setenv("TZ", tz, 1);
+    tzset();
+}
@@ -0,0 +1,14 @@
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+// Pad holds only matter across deep sleep, which the host never enters
+#include "../esp_err.h"
+
+typedef int gpio_num_t;
+
+inline esp_err_t gpio_hold_en(gpio_num_t) { return ESP_OK; }
+inline esp_err_t gpio_hold_dis(gpio_num_t) { return ESP_OK; }
+inline void gpio_deep_sleep_hold_en() {}
+inline void gpio_deep_sleep_hold_dis() {}
+
+#endif // HOST_DRIVER_GPIO_H
@@ -0,0 +1,7 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// No RTC memory on the host: RTC_DATA_ATTR variables are ordinary statics
+#define RTC_DATA_ATTR
+
+#endif // HOST_ESP_ATTR_H
@@ -0,0 +1,17 @@
+#ifndef HOST_ESP_PM_H
+#define HOST_ESP_PM_H
+
+// Power management as in a CONFIG_PM_ENABLE build; configuring it does nothing
+#include "esp_err.h"
+
+#define CONFIG_PM_ENABLE 1
+
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_esp32_t;
+
+inline esp_err_t esp_pm_configure(const void*) { return ESP_OK; }
+
+#endif // HOST_ESP_PM_H
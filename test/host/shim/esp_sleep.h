@@ -0,0 +1,15 @@
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+// Every start is a power-on; the simulations never call esp_deep_sleep_start()
+#include <stdint.h>
+#include <stdlib.h>
+#include "esp_err.h"
+
+typedef enum { ESP_SLEEP_WAKEUP_UNDEFINED, ESP_SLEEP_WAKEUP_TIMER } esp_sleep_wakeup_cause_t;
+
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t) { return ESP_OK; }
+inline void esp_deep_sleep_start() { abort(); }
+
+#endif // HOST_ESP_SLEEP_H
@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_SNTP_H
+#define HOST_ESP_SNTP_H
+
+// No SNTP on the host: the sync callback is never called
+struct timeval;
+inline void sntp_set_time_sync_notification_cb(void (*)(struct timeval*)) {}
+
+#endif // HOST_ESP_SNTP_H
@@ -0,0 +1,12 @@
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+#include "esp_err.h"
+
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+inline esp_err_t esp_wifi_set_ps(wifi_ps_type_t) { return ESP_OK; }
+// From the Arduino core (esp32-hal-cpu.h) on the device
+inline bool setCpuFrequencyMhz(uint32_t) { return true; }
+
+#endif // HOST_ESP_WIFI_H
@@ -0,0 +1,194 @@
+/*
+ * freertos_shim.cpp
+ *
+ * std::thread stand-ins for the FreeRTOS and esp_timer calls the control logic makes,
+ * so ControlTask, EventLog and TransitionTimer run unchanged on Linux.
+ */
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+// --- Tasks ---
+
+// A task's notification count and delete request. Records are never freed: a
+// deleted task may still be inside a call that looks at its own record.
+struct HostTask {
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    uint32_t notifications = 0;
+    std::atomic<bool> deleted{false};
+};
+
+static thread_local HostTask* currentTask = nullptr;
+
+// A deleted task's thread ends at its next blocking call, as FreeRTOS would stop scheduling it
+static void exitIfDeleted() {
+    if (currentTask && currentTask->deleted.load()) pthread_exit(nullptr);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char*, uint32_t, void* arg,
+                                   int, TaskHandle_t* handle, BaseType_t) {
+    HostTask* task = new HostTask;
+    if (handle) *handle = task;
+    std::thread([task, function, arg]() {
+        currentTask = task;
+        function(arg);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackSize, void* arg,
+                       int priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stackSize, arg, priority, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    HostTask* task = handle ? static_cast<HostTask*>(handle) : currentTask;
+    if (!task) return;
+    task->deleted.store(true);
+    task->wakeup.notify_all();
+    exitIfDeleted();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+    exitIfDeleted();
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)(esp_timer_get_time() / 1000); }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    HostTask* task = static_cast<HostTask*>(handle);
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifications++;
+    }
+    task->wakeup.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    HostTask* task = currentTask;
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->wakeup.wait_for(lock, std::chrono::milliseconds(ticksToWait),
+                          [task]() { return task->notifications > 0 || task->deleted.load(); });
+    lock.unlock();
+    exitIfDeleted();
+    lock.lock();
+    uint32_t count = task->notifications;
+    task->notifications = clearOnExit ? 0 : (count ? count - 1 : 0);
+    return count;
+}
+
+BaseType_t xPortGetCoreID() { return 0; }
+
+// --- Locks ---
+
+static std::recursive_mutex criticalSection;
+
+void portENTER_CRITICAL(portMUX_TYPE*) { criticalSection.lock(); }
+void portEXIT_CRITICAL(portMUX_TYPE*) { criticalSection.unlock(); }
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new std::recursive_timed_mutex; }
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t handle, TickType_t ticksToWait) {
+    std::recursive_timed_mutex* mutex = static_cast<std::recursive_timed_mutex*>(handle);
+    if (ticksToWait == portMAX_DELAY) {
+        mutex->lock();
+    } else if (!mutex->try_lock_for(std::chrono::milliseconds(ticksToWait))) {
+        return pdFALSE;
+    }
+    if (currentTask && currentTask->deleted.load()) {
+        mutex->unlock();
+        pthread_exit(nullptr);
+    }
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t handle) {
+    static_cast<std::recursive_timed_mutex*>(handle)->unlock();
+    return pdTRUE;
+}
+
+// --- esp_timer ---
+
+// One thread per timer waits for the deadline and runs the callback on it
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool armed = false;
+    bool deleting = false;
+    std::chrono::steady_clock::time_point deadline;
+    std::thread thread;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!deleting) {
+            if (!armed) {
+                changed.wait(lock);
+            } else if (changed.wait_until(lock, deadline) == std::cv_status::timeout && armed &&
+                       std::chrono::steady_clock::now() >= deadline) {
+                armed = false;
+                lock.unlock();
+                callback(arg);
+                lock.lock();
+            }
+        }
+    }
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    esp_timer* timer = new esp_timer;
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->thread = std::thread([timer]() { timer->run(); });
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        if (timer->armed) return ESP_FAIL;  // Like ESP_ERR_INVALID_STATE: stop it first
+        timer->deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+        timer->armed = true;
+    }
+    timer->changed.notify_one();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer) return ESP_FAIL;
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    bool wasArmed = timer->armed;
+    timer->armed = false;
+    return wasArmed ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) return ESP_FAIL;
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        timer->deleting = true;
+    }
+    timer->changed.notify_one();
+    timer->thread.join();
+    delete timer;
+    return ESP_OK;
+}
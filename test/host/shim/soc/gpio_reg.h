@@ -0,0 +1,23 @@
+#ifndef HOST_SOC_GPIO_REG_H
+#define HOST_SOC_GPIO_REG_H
+
+// GPIO set/clear registers for pins 0-31 and 32-39. A write sets or clears
+// every pin whose bit is set, through digitalWrite(), so digitalRead() sees it.
+#include <Arduino.h>
+
+#define GPIO_OUT_W1TS_REG 0
+#define GPIO_OUT_W1TC_REG 1
+#define GPIO_OUT1_W1TS_REG 2
+#define GPIO_OUT1_W1TC_REG 3
+
+inline void hostGpioRegWrite(int reg, uint32_t bits) {
+    int firstPin = reg >= GPIO_OUT1_W1TS_REG ? 32 : 0;
+    int level = (reg == GPIO_OUT_W1TS_REG || reg == GPIO_OUT1_W1TS_REG) ? HIGH : LOW;
+    for (int b = 0; b < 32; b++) {
+        if ((bits >> b) & 1) digitalWrite(firstPin + b, level);
+    }
+}
+
+#define REG_WRITE(reg, value) hostGpioRegWrite((reg), (value))
+
+#endif // HOST_SOC_GPIO_REG_H
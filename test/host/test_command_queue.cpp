@@ -0,0 +1,60 @@
+// CommandQueue: many producers, one consumer, every command delivered once and in order per producer
+#include "command_queue.h"
+#include "host_test.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+int main() {
+    // Contention: producer p sends 0..N-1 in zone p; the consumer checks each producer's order
+    {
+        const int PRODUCERS = 4;
+        const int N = 20000;
+        CommandQueue queue;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < PRODUCERS; p++) {
+            producers.emplace_back([&queue, p]() {
+                for (int i = 0; i < N; i++) {
+                    ControlCommand command = {};
+                    command.zone = p;
+                    command.value = i;
+                    while (queue.push(command) == 0) std::this_thread::yield();
+                }
+            });
+        }
+        int next[PRODUCERS] = {};
+        long received = 0;
+        ControlCommand command;
+        while (received < (long)PRODUCERS * N) {
+            if (!queue.pop(command)) continue;
+            CHECK(command.zone >= 0 && command.zone < PRODUCERS);
+            CHECK(command.value == next[command.zone]);
+            next[command.zone]++;
+            queue.complete(command.sequence, CommandStatus::Done);
+            received++;
+        }
+        for (std::thread& producer : producers) producer.join();
+        CHECK(!queue.pop(command));
+        printf("%ld commands from %d producers\n", received, PRODUCERS);
+    }
+
+    // Full queue: push fails, statuses stay Pending until completed
+    {
+        CommandQueue queue;
+        ControlCommand command = {};
+        uint32_t first = 0;
+        for (uint32_t i = 0; i < CommandQueue::CAPACITY; i++) {
+            uint32_t sequence = queue.push(command);
+            CHECK(sequence == i + 1);
+            if (!first) first = sequence;
+        }
+        CHECK(queue.push(command) == 0);
+        CHECK(queue.status(first) == CommandStatus::Pending);
+        CHECK(queue.pop(command) && command.sequence == first);
+        queue.complete(command.sequence, CommandStatus::Rejected);
+        CHECK(queue.status(first) == CommandStatus::Rejected);
+        CHECK(queue.push(command) == CommandQueue::CAPACITY + 1);
+    }
+    puts("test_command_queue: ok");
+    return 0;
+}
@@ -0,0 +1,122 @@
+// ControlTask on a std::thread: scheduled runs reach the relays, commands from concurrent
+// handlers are applied, and the published snapshot stays consistent while they run
+#include "control_task.h"
+#include "epoch_day.h"
+#include "host_test.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static const int ZONES = 4;
+static const int pins[ZONES] = {13, 12, 14, 27};
+static const bool activeLow[ZONES] = {false, false, false, false};
+
+static void sleepMs(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// activeZone is the highest zone on; masks only name existing zones
+static bool consistent(const ControlSnapshot& snapshot) {
+    int highest = snapshot.zoneOnMask ? 31 - __builtin_clz(snapshot.zoneOnMask) : -1;
+    uint32_t zones = (1UL << ZONES) - 1;
+    return snapshot.activeZone == highest && (snapshot.zoneOnMask & ~zones) == 0 &&
+           (snapshot.zoneDisabledMask & ~zones) == 0;
+}
+
+int main() {
+    SprinklerController controller(pins, activeLow, ZONES, -1);
+    ScheduleManager scheduleManager(ZONES, &controller);
+    scheduleManager.initializePrograms();
+    SprinklerSystemState manualState;
+
+    // Program A waters zone 2 from the current minute
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    Program& program = scheduleManager.programs[0];
+    program.enabled = true;
+    for (int d = 0; d < 7; d++) program.daysOfWeek[d] = true;
+    program.startTimes[0] = local.tm_hour * 60 + local.tm_min;
+    program.durations[2] = 5;
+
+    ControlTask task(scheduleManager, manualState, controller);
+    CHECK(controlSnapshot().activeZone == -1);
+    // Nothing runs commands before begin(); this one stays queued and runs on the first pass
+    CHECK(runControlCommand(CommandType::EnableZone, 0, -1, 0, 20) == CommandStatus::TimedOut);
+    task.begin();
+    CHECK(task.isRunning());
+    sleepMs(50);
+
+    ControlSnapshot snapshot = controlSnapshot();
+    CHECK(snapshot.passes > 3);
+    CHECK(snapshot.zoneOnMask == 0x04 && snapshot.scheduledMask == 0x04);
+    CHECK(snapshot.activeZone == 2 && snapshot.activeProgram == 0);
+    CHECK(digitalRead(pins[2]) == HIGH && digitalRead(pins[1]) == LOW);
+
+    // A handler edit under ControlLock: the next pass switches the disabled zone off
+    {
+        ControlLock lock;
+        scheduleManager.sprinklers[2].disabled = true;
+        scheduleManager.requestScheduleCheck();
+    }
+    sleepMs(30);
+    snapshot = controlSnapshot();
+    CHECK(snapshot.zoneOnMask == 0 && snapshot.zoneDisabledMask == 0x04 && snapshot.activeZone == -1);
+    CHECK(digitalRead(pins[2]) == LOW);
+    CHECK(runControlCommand(CommandType::EnableZone, 2) == CommandStatus::Done);
+
+    // Commands: the snapshot already shows the result when runControlCommand() returns
+    CHECK(runControlCommand(CommandType::DisableZone, 9) == CommandStatus::Rejected);
+    CHECK(runControlCommand(CommandType::ToggleManualMode) == CommandStatus::Done);
+    CHECK(controlSnapshot().manualMode);
+    CHECK(runControlCommand(CommandType::ToggleZone, 3) == CommandStatus::Done);
+    CHECK((controlSnapshot().zoneOnMask & 0x08) != 0);
+
+    // Handlers toggling zones while readers check every snapshot they get
+    std::atomic<bool> done(false);
+    std::atomic<long> reads(0);
+    std::atomic<long> inconsistent(0);
+    std::atomic<long> backwards(0);
+    std::atomic<int> applied(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++) {
+        readers.emplace_back([&]() {
+            uint32_t lastPasses = 0;
+            while (!done.load()) {
+                ControlSnapshot seen = controlSnapshot();
+                if (!consistent(seen)) inconsistent++;
+                if (seen.passes < lastPasses) backwards++;
+                lastPasses = seen.passes;
+                reads++;
+            }
+        });
+    }
+    std::vector<std::thread> handlers;
+    for (int h = 0; h < 4; h++) {
+        handlers.emplace_back([&, h]() {
+            for (int i = 0; i < 100; i++) {
+                CommandStatus status = runControlCommand(CommandType::ToggleZone, (h + i) % ZONES);
+                CHECK(status == CommandStatus::Done || status == CommandStatus::QueueFull);
+                if (status == CommandStatus::Done) applied++;
+            }
+        });
+    }
+    for (std::thread& handler : handlers) handler.join();
+    done.store(true);
+    for (std::thread& reader : readers) reader.join();
+    printf("%d commands applied, %ld snapshot reads: %ld inconsistent, %ld out of order\n", applied.load(),
+           reads.load(), inconsistent.load(), backwards.load());
+    CHECK(applied.load() > 0);
+    CHECK(inconsistent.load() == 0 && backwards.load() == 0);
+
+    // Relays follow the last published mask
+    snapshot = controlSnapshot();
+    for (int z = 0; z < ZONES; z++) CHECK(digitalRead(pins[z]) == (((snapshot.zoneOnMask >> z) & 1) ? HIGH : LOW));
+
+    task.end();
+    CHECK(!task.isRunning());
+    uint32_t passes = controlSnapshot().passes;
+    sleepMs(20);
+    CHECK(controlSnapshot().passes == passes);
+    puts("test_control_task: ok");
+    return 0;
+}
@@ -0,0 +1,47 @@
+// RunArbiter: priorities, preemption with pause and resume, and the next-transition deadline
+#include "run_arbiter.h"
+#include "host_test.h"
+
+int main() {
+    RunArbiter arbiter;
+    uint64_t at;
+    CHECK(arbiter.advance(0) == RunSource::COUNT && arbiter.zoneMask(0) == 0 && !arbiter.nextTransition(0, at));
+
+    // The schedule holds zone 4 until told otherwise
+    arbiter.hold(RunSource::Schedule, 0x10);
+    CHECK(arbiter.advance(0) == RunSource::Schedule && arbiter.zoneMask(0) == 0x10);
+    CHECK(!arbiter.nextTransition(0, at));
+
+    // A Quick Run over zones 0-2, one second each, takes over
+    RunSegment quickRun[3] = {{0, 1000, 0}, {1000, 2000, 1}, {2000, 3000, 2}};
+    CHECK(arbiter.startTimed(RunSource::QuickRun, 0, quickRun, 3, 100));
+    CHECK(arbiter.advance(100) == RunSource::QuickRun && arbiter.zoneMask(100) == 1);
+    CHECK(arbiter.nextTransition(100, at) && at == 1100);
+
+    // Run Program Now preempts it 500 ms into zone 1; its segments overlap
+    RunSegment program[2] = {{0, 500, 3}, {200, 700, 4}};
+    CHECK(arbiter.startTimed(RunSource::RunProgramNow, 2, program, 2, 1600));
+    CHECK(arbiter.advance(1600) == RunSource::RunProgramNow && arbiter.zoneMask(1600) == 0x08);
+    CHECK(arbiter.isPaused(RunSource::QuickRun));
+    CHECK(arbiter.nextTransition(1600, at) && at == 1800);
+    CHECK(arbiter.advance(1900) == RunSource::RunProgramNow && arbiter.zoneMask(1900) == 0x18);
+    CHECK(arbiter.program(RunSource::RunProgramNow) == 2);
+
+    // Manual mode ranks below the timed runs; the Quick Run resumes with zone 1's remaining 500 ms
+    arbiter.hold(RunSource::Manual, 0x20);
+    CHECK(arbiter.advance(2300) == RunSource::QuickRun && !arbiter.isActive(RunSource::RunProgramNow));
+    CHECK(arbiter.zoneMask(2300) == 0x02 && arbiter.currentSegment(RunSource::QuickRun, 2300) == 1);
+    CHECK(arbiter.nextTransition(2300, at) && at == 2800);
+    CHECK(arbiter.advance(2800) == RunSource::QuickRun && arbiter.zoneMask(2800) == 0x04);
+    CHECK(arbiter.advance(3800) == RunSource::Manual && arbiter.zoneMask(3800) == 0x20);
+    CHECK(!arbiter.isActive(RunSource::QuickRun));
+    arbiter.stop(RunSource::Manual);
+    CHECK(arbiter.advance(3800) == RunSource::Schedule && arbiter.zoneMask(3800) == 0x10);
+
+    // Runs that would open nothing are refused
+    RunSegment empty[1] = {{0, 0, 1}};
+    CHECK(!arbiter.startTimed(RunSource::QuickRun, 0, empty, 1, 0));
+    CHECK(!arbiter.startTimed(RunSource::QuickRun, 0, empty, 0, 0));
+    puts("test_run_arbiter: ok");
+    return 0;
+}
@@ -0,0 +1,113 @@
+// SeqLock: readers on other threads never see a torn value while one writer publishes,
+// for the ControlSnapshot the control task publishes and for a block large enough that
+// writes are often preempted halfway (so a broken lock is caught on a single core too)
+#include "control_task.h"
+#include "host_test.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Every field is derived from n, so a snapshot mixing two writes fails consistent()
+static ControlSnapshot snapshotFor(uint32_t n) {
+    ControlSnapshot snapshot = {};
+    snapshot.passes = n;
+    snapshot.zoneOnMask = n * 2654435761u;
+    snapshot.zoneDisabledMask = ~n;
+    snapshot.scheduledMask = n ^ 0x5A5A5A5Au;
+    snapshot.activeZone = (int8_t)(n % 32);
+    snapshot.activeProgram = (int8_t)(n % 16);
+    snapshot.runProgramNowIndex = (int8_t)(n % 7);
+    snapshot.quickRunZone = (int8_t)(n % 5);
+    snapshot.manualMode = n & 1;
+    snapshot.relayWrites = n * 3;
+    snapshot.firstScheduleMs = n + 12345;
+    return snapshot;
+}
+
+static bool consistent(const ControlSnapshot& snapshot) {
+    ControlSnapshot expected = snapshotFor(snapshot.passes);
+    return snapshot.zoneOnMask == expected.zoneOnMask && snapshot.zoneDisabledMask == expected.zoneDisabledMask &&
+           snapshot.scheduledMask == expected.scheduledMask && snapshot.activeZone == expected.activeZone &&
+           snapshot.activeProgram == expected.activeProgram &&
+           snapshot.runProgramNowIndex == expected.runProgramNowIndex &&
+           snapshot.quickRunZone == expected.quickRunZone && snapshot.manualMode == expected.manualMode &&
+           snapshot.relayWrites == expected.relayWrites && snapshot.firstScheduleMs == expected.firstScheduleMs;
+}
+
+struct Block {
+    uint32_t words[1024];
+};
+
+static void checkLargeBlock() {
+    const uint32_t WRITES = 100000;
+    SeqLock<Block>* published = new SeqLock<Block>;
+    std::atomic<bool> done(false);
+    long reads = 0;
+    long torn = 0;
+    std::thread reader([&]() {
+        while (!done.load()) {
+            Block block = published->read();
+            for (int i = 1; i < 1024; i++) {
+                if (block.words[i] != block.words[0]) {
+                    torn++;
+                    break;
+                }
+            }
+            reads++;
+        }
+    });
+    Block block;
+    for (uint32_t n = 1; n <= WRITES; n++) {
+        for (int i = 0; i < 1024; i++) block.words[i] = n;
+        published->write(block);
+    }
+    done.store(true);
+    reader.join();
+    printf("%ld reads of a 4 KB block during %u writes: %ld torn\n", reads, WRITES, torn);
+    CHECK(torn == 0);
+    delete published;
+}
+
+int main() {
+    checkLargeBlock();
+
+    const uint32_t WRITES = 1000000;
+    const int READERS = 3;
+    SeqLock<ControlSnapshot> published;
+    published.write(snapshotFor(0));
+    CHECK(published.writes() == 1);
+
+    std::atomic<bool> done(false);
+    std::atomic<long> reads(0);
+    std::atomic<long> torn(0);
+    std::atomic<long> backwards(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&]() {
+            uint32_t last = 0;
+            while (!done.load()) {
+                ControlSnapshot snapshot = published.read();
+                if (!consistent(snapshot)) torn++;
+                if (snapshot.passes < last) backwards++;
+                last = snapshot.passes;
+                reads++;
+            }
+        });
+    }
+    std::thread writer([&]() {
+        for (uint32_t n = 1; n <= WRITES; n++) published.write(snapshotFor(n));
+        done.store(true);
+    });
+    writer.join();
+    for (std::thread& reader : readers) reader.join();
+
+    printf("%ld reads during %u writes: %ld torn, %ld out of order\n", reads.load(), WRITES, torn.load(),
+           backwards.load());
+    CHECK(torn.load() == 0);
+    CHECK(backwards.load() == 0);
+    CHECK(reads.load() > 0);
+    CHECK(published.writes() == WRITES + 1);
+    CHECK(published.read().passes == WRITES);
+    puts("test_seqlock: ok");
+    return 0;
+}
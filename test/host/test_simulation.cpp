@@ -0,0 +1,49 @@
+// Year and deep-sleep simulations: deterministic, the live state left alone, and the
+// deep-sleep run watering exactly like the always-awake one with no relay late
+#include "control_task.h"
+#include "monotonic_clock.h"
+#include "schedule_bench.h"
+#include "wall_clock.h"
+#include "host_test.h"
+#include <vector>
+
+static const time_t START = 1735686000;  // 2025-01-01 00:00 CET
+
+static void record(const YearSimTransition& transition, void* context) {
+    static_cast<std::vector<YearSimTransition>*>(context)->push_back(transition);
+}
+
+int main() {
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+
+    std::vector<YearSimTransition> awake;
+    YearSimResult year = runYearSimulation(365, START, record, &awake);
+    printf("year: %u passes, %u relay changes, %u us\n", year.passes, year.transitions, year.wallMicros);
+    CHECK(year.days == 365 && year.transitions > 1000);
+    CHECK(awake.size() == year.transitions);
+    for (size_t i = 1; i < awake.size(); i++) CHECK(awake[i].at >= awake[i - 1].at);
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) CHECK(year.zoneOnMinutes[z] > 0);
+    CHECK(!WallClock::isSimulated() && !MonotonicClock::isManual());
+    CHECK(controlSnapshot().passes == 0);
+
+    YearSimResult again = runYearSimulation(365, START);
+    CHECK(again.passes == year.passes && again.transitions == year.transitions);
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) CHECK(again.zoneOnMinutes[z] == year.zoneOnMinutes[z]);
+
+    std::vector<YearSimTransition> sleeping;
+    DeepSleepSimResult deepSleep = runDeepSleepSimulation(365, START, record, &sleeping);
+    printf("deep sleep: %u sleeps, %u scheduled wakes, awake %u s, wake to relay %u ms, %u us\n",
+           deepSleep.sleeps, deepSleep.scheduledWakes, deepSleep.awakeSeconds, deepSleep.maxWakeToRelayMs,
+           deepSleep.wallMicros);
+    CHECK(sleeping.size() == awake.size());
+    for (size_t i = 0; i < awake.size(); i++) {
+        CHECK(sleeping[i].at == awake[i].at && sleeping[i].zoneMask == awake[i].zoneMask);
+    }
+    for (int z = 0; z < YEAR_SIM_ZONES; z++) CHECK(deepSleep.zoneOnMinutes[z] == year.zoneOnMinutes[z]);
+    CHECK(deepSleep.sleeps > 300 && deepSleep.maxRelayLateMs <= 0);
+    CHECK(deepSleep.awakeSeconds < 365u * 86400 / 10);
+    CHECK(!WallClock::isSimulated() && !MonotonicClock::isManual());
+    puts("test_simulation: ok");
+    return 0;
+}
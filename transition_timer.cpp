@@ -0,0 +1,32 @@
+/**
+ * @file transition_timer.cpp
+ * @brief One-shot zone transition timer (esp_timer).
+ */
+
+#include "transition_timer.h"
+
+void TransitionTimer::begin() {
+    if (_handle) return;
+    esp_timer_create_args_t args = {};
+    args.callback = _callback;
+    args.arg = _arg;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "zone_transition";
+    esp_timer_create(&args, &_handle);
+}
+
+TransitionTimer::~TransitionTimer() {
+    if (!_handle) return;
+    esp_timer_stop(_handle);
+    esp_timer_delete(_handle);
+}
+
+void TransitionTimer::armInMicros(uint64_t delayUs) {
+    if (!_handle) return;
+    esp_timer_stop(_handle); // Fails harmlessly if not running
+    esp_timer_start_once(_handle, delayUs);
+}
+
+void TransitionTimer::cancel() {
+    if (_handle) esp_timer_stop(_handle);
+}
@@ -0,0 +1,35 @@
+#ifndef TRANSITION_TIMER_H
+#define TRANSITION_TIMER_H
+
+#include <stdint.h>
+#include <esp_timer.h>
+
+/**
+ * @brief One-shot timer that calls back when the next zone transition is due.
+ *
+ * Wraps an esp_timer, whose callbacks run in the high priority esp_timer
+ * task regardless of what loop() or the web server are doing. The esp_timer
+ * is created by begin(), so an object that is never started costs nothing;
+ * until then arming and cancelling do nothing. Arming again replaces the
+ * pending deadline.
+ */
+class TransitionTimer {
+public:
+    typedef void (*Callback)(void* arg);
+
+    TransitionTimer(Callback callback, void* arg) : _callback(callback), _arg(arg) {}
+    ~TransitionTimer();
+    TransitionTimer(const TransitionTimer&) = delete;
+    TransitionTimer& operator=(const TransitionTimer&) = delete;
+
+    void begin();                 // Create the esp_timer
+    void armInMicros(uint64_t delayUs); // Call back once, delayUs from now
+    void cancel();
+
+private:
+    Callback _callback;
+    void* _arg;
+    esp_timer_handle_t _handle = nullptr;
+};
+
+#endif // TRANSITION_TIMER_H
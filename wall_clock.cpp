@@ -0,0 +1,45 @@
+/**
+ * @file wall_clock.cpp
+ * @brief System or simulated calendar time.
+ */
+
+#include "wall_clock.h"
+#include <sys/time.h>
+#include "monotonic_clock.h"
+
+// Per thread, like manual MonotonicClock time
+static thread_local bool simulated = false;
+static thread_local int64_t simStartMs = 0;       // Wall time at simulate()
+static thread_local uint64_t simMonotonicMs = 0;  // MonotonicClock time at simulate()
+
+int64_t WallClock::nowMs() {
+    if (simulated) return simStartMs + (int64_t)(MonotonicClock::nowMs() - simMonotonicMs);
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+time_t WallClock::now() {
+    if (simulated) return (time_t)(nowMs() / 1000);
+    return time(nullptr);
+}
+
+void WallClock::localNow(struct tm& out) {
+    time_t t = now();
+    localtime_r(&t, &out);
+}
+
+void WallClock::simulate(time_t startEpoch) {
+    if (!MonotonicClock::isManual()) MonotonicClock::setManual(0);
+    simStartMs = (int64_t)startEpoch * 1000;
+    simMonotonicMs = MonotonicClock::nowMs();
+    simulated = true;
+}
+
+void WallClock::useSystem() {
+    simulated = false;
+}
+
+bool WallClock::isSimulated() {
+    return simulated;
+}
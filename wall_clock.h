@@ -0,0 +1,29 @@
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Calendar time for the schedule, pages and loop(), in one place.
+ *
+ * Normally the system clock (NTP-set, timezone from TZ). In a simulation it
+ * is tied to MonotonicClock manual time instead: it reads the given start
+ * time when simulate() is called and moves with MonotonicClock::advance(),
+ * so the control logic can be run over months of calendar in seconds. Like
+ * manual MonotonicClock time, simulation applies to the calling thread only.
+ */
+class WallClock {
+public:
+    static time_t now();        // Seconds since the epoch
+    static int64_t nowMs();     // Milliseconds since the epoch
+    static void localNow(struct tm& out); // now() in local time
+
+    // Simulation (calling thread): start at startEpoch and follow MonotonicClock
+    // manual time (switched to manual here if it is not already)
+    static void simulate(time_t startEpoch);
+    static void useSystem();
+    static bool isSimulated();
+};
+
+#endif // WALL_CLOCK_H
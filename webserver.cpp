@@ -22,10 +22,12 @@ bool currentDstEnabled = false;
 #include "webserver.h"
 #include "config.h"
 #include "network.h"
+#include "wall_clock.h"
 
 void handleCurrentTime(WebServer& server) {
-    time_t now = time(nullptr);
-    struct tm *t = localtime(&now);
+    struct tm local;
+    WallClock::localNow(local);
+    struct tm *t = &local;
     char buf[9];
     snprintf(buf, sizeof(buf), "%02d:%02d:%02d", t->tm_hour, t->tm_min, t->tm_sec);
     String time12 = formatTime12Hour(String(buf));
@@ -36,6 +38,14 @@ void handleCurrentTime(WebServer& server) {
 #include "schedule.h"
 #include "timeprefs.h"
 #include "program_page.h"
+#include "schedule_bench.h"
+#include "boot_status.h"
+#include "control_task.h"
+#include "deep_sleep.h"
+#include "event_log.h"
+#include "latency_stats.h"
+#include "monotonic_clock.h"
+#include "power_policy.h"
 
 // OTA Setup
 void setupOTA() {
@@ -43,12 +53,14 @@ void setupOTA() {
     
     ArduinoOTA.onStart([]() {
         String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
+        powerPolicy.noteActivity(MonotonicClock::nowMs());
     });
     
     ArduinoOTA.onEnd([]() {
     });
     
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
+        powerPolicy.noteActivity(MonotonicClock::nowMs()); // Full speed for the whole transfer
     });
     
     ArduinoOTA.onError([](ota_error_t error) {
@@ -118,21 +130,107 @@ void handleWiFiSetup(WebServer& server) {
     ESP.restart();
 }
 
+// Reply with an error if a queued control command did not complete; true if a reply was sent
+static bool sendCommandFailure(WebServer& server, CommandStatus status) {
+    switch (status) {
+    case CommandStatus::Done:
+        return false;
+    case CommandStatus::Rejected:
+        server.send(400, "text/plain", "Rejected");
+        break;
+    case CommandStatus::TimedOut:
+        server.send(503, "text/plain", "Controller busy, command queued");
+        break;
+    default:
+        server.send(503, "text/plain", "Controller busy, try again");
+        break;
+    }
+    return true;
+}
+
+// Map a timezone name and DST setting to a TZ string
+static const char* timezoneString(const String& tzName, bool dst) {
+    if (tzName == "Eastern") return dst ? "EST5EDT,M3.2.0/2,M11.1.0/2" : "EST5";
+    if (tzName == "Central") return dst ? "CST6CDT,M3.2.0/2,M11.1.0/2" : "CST6";
+    if (tzName == "Mountain") return dst ? "MST7MDT,M3.2.0/2,M11.1.0/2" : "MST7";
+    if (tzName == "Pacific") return dst ? "PST8PDT,M3.2.0/2,M11.1.0/2" : "PST8";
+    if (tzName == "Alaska") return dst ? "AKST9AKDT,M3.2.0/2,M11.1.0/2" : "AKST9";
+    if (tzName == "Hawaii") return "HST10"; // Hawaii does not observe DST
+    return "EST5EDT,M3.2.0/2,M11.1.0/2"; // Default
+}
+
+// Load the stored timezone/DST and apply it; needs no network, so the schedule
+// runs on local time from boot on
+void loadTimezonePreferences() {
+    Preferences prefs;
+    prefs.begin("sprinkler_time", true);
+    currentTimeZoneName = prefs.getString("timezone", "Eastern");
+    currentDstEnabled = prefs.getBool("dst", false);
+    prefs.end();
+    setenv("TZ", timezoneString(currentTimeZoneName, currentDstEnabled), 1);
+    tzset();
+}
+
+// Start NTP in the current timezone (once WiFi is connected)
+void startTimeSync() {
+    configTzTime(timezoneString(currentTimeZoneName, currentDstEnabled), "pool.ntp.org", "time.nist.gov");
+}
+
+// First relay changes of a simulation, as a JSON array
+struct SimTrace {
+    String json;
+    int limit;
+    int count;
+};
+
+static void collectSimTrace(const YearSimTransition& transition, void* context) {
+    SimTrace& trace = *static_cast<SimTrace*>(context);
+    if (trace.count >= trace.limit) return;
+    if (trace.count++ > 0) trace.json += ",";
+    trace.json += "{\"at\":" + String((long)transition.at) + ",\"zones\":" + String(transition.zoneMask) + "}";
+}
+
+// Deep sleep setting, next program start and wake statistics
+static void sendDeepSleepStatus(WebServer& server, ScheduleManager& scheduleManager) {
+    time_t now = WallClock::now();
+    time_t nextStart = 0;
+    int nextProgram = -1;
+    {
+        ControlLock lock;
+        nextProgramStart(scheduleManager, now, nextStart, nextProgram);
+    }
+    server.send(200, "application/json", deepSleep.toJson(now, nextStart, nextProgram));
+}
+
+// Simulations start at today's local midnight, or 2025-01-01 before the clock is set
+static time_t simulationStart() {
+    if (!isClockValid(WallClock::now())) return 1735689600;
+    struct tm local;
+    WallClock::localNow(local);
+    local.tm_hour = local.tm_min = local.tm_sec = 0;
+    local.tm_isdst = -1;
+    return mktime(&local);
+}
+
+// Register a route and record its handler time in a latency probe named "<method> <path>"
+static void onTimed(WebServer& server, const String& path, HTTPMethod method, WebServer::THandlerFunction handler) {
+    String name = String(method == HTTP_POST ? "POST " : "GET ") + path;
+    LatencyProbe* probe = latencyStats.probe(name.c_str());
+    server.on(path, method, [probe, handler]() {
+        ScopedLatency timer(probe);
+        powerPolicy.noteActivity(MonotonicClock::nowMs());
+        handler();
+    });
+}
+
 // Web Server Routes Setup
 void setupWebServerRoutes(
     WebServer& server, 
     ScheduleManager& scheduleManager, 
     SprinklerSystemState& manualState
 ) {
-    // --- Run Program Now API endpoint ---
-    server.on("/run_now", HTTP_POST, [&]() {
-        int programIndex = server.hasArg("program") ? server.arg("program").toInt() : 0;
-        scheduleManager.startRunProgramNow(programIndex);
-        scheduleManager.savePrograms();
-        server.send(200, "text/plain", "OK");
-    });
     // --- Stop Run Program Now API endpoint ---
-    server.on("/stop_program_now", HTTP_POST, [&]() {
+    onTimed(server, "/stop_program_now", HTTP_POST, [&]() {
         // Accept both JSON and form data for program index, but always stop
         if (server.args() > 0) {
             String body = server.arg(0);
@@ -140,83 +238,74 @@ void setupWebServerRoutes(
             DeserializationError error = deserializeJson(doc, body);
             // program index is ignored, but parsed for completeness
         }
-        scheduleManager.stopRunProgramNow();
+        if (sendCommandFailure(server, runControlCommand(CommandType::StopProgramNow))) return;
         server.send(200, "text/plain", "OK");
     });
     // --- Real-time zone status endpoint ---
-    server.on("/zone_status", HTTP_GET, [&]() {
+    onTimed(server, "/zone_status", HTTP_GET, [&]() {
+        // Published by the control task after every pass; reading it never blocks
+        ControlSnapshot snapshot = controlSnapshot();
         String json = "{\"zones\": [";
-        int activeZone = -1;
-        int activeProgram = -1;
-        // Find the currently active zone and its program (Quick Run or scheduled)
         for (int i = 0; i < scheduleManager.count; i++) {
-            if (scheduleManager.sprinklers[i].state) {
-                activeZone = i;
-                // Try to detect which program is running this zone (Quick Run or scheduled)
-                // If Quick Run is active, use quickRunProgramIndex (must be tracked)
-                // Otherwise, check calculatedSchedules
-                if (scheduleManager.getCurrentRunProgramNowIndex() >= 0) {
-                    activeProgram = scheduleManager.getCurrentRunProgramNowIndex();
-                } else if (scheduleManager.isQuickRunActive()) {
-                    activeProgram = 0; // Quick Run, still default to 0
-                } else {
-                    // Fallback: check which program's calculatedSchedule is currently ON
-                    for (int p = 0; p < 3; p++) {
-                        if (scheduleManager.sprinklers[i].calculatedSchedules[p].programIndex == p) {
-                            activeProgram = p;
-                            break;
-                        }
-                    }
-                }
-            }
-            json += String("{\"id\":") + i + ",\"on\":" + (scheduleManager.sprinklers[i].state ? "true" : "false") + ",\"disabled\":" + (scheduleManager.sprinklers[i].disabled ? "true" : "false") + "}";
+            bool on = (snapshot.zoneOnMask >> i) & 1;
+            bool disabled = (snapshot.zoneDisabledMask >> i) & 1;
+            json += String("{\"id\":") + i + ",\"on\":" + (on ? "true" : "false") + ",\"disabled\":" + (disabled ? "true" : "false") + "}";
             if (i < scheduleManager.count - 1) json += ",";
         }
-        json += "],\"active\":" + String(activeZone) + ",\"activeProgram\":" + String(activeProgram) + "}";
+        json += "],\"active\":" + String(snapshot.activeZone) + ",\"activeProgram\":" + String(snapshot.activeProgram);
+        json += ",\"relayWrites\":" + String(snapshot.relayWrites) + "}";
         server.send(200, "application/json", json);
     });
 
-    // Handler for Run Program Now (POST)
-    server.on("/run_now", HTTP_POST, [&]() {
+    // Handler for Run Program Now (POST); the program comes as a form/query argument or a JSON body.
+    // The control task saves the moved start time under ControlLock.
+    onTimed(server, "/run_now", HTTP_POST, [&]() {
         if (server.args() == 0) {
             server.send(400, "text/plain", "Missing body");
             return;
         }
-        String body = server.arg(0);
         int progIdx = -1;
-        // Parse JSON body
-        StaticJsonDocument<64> doc;
-        DeserializationError error = deserializeJson(doc, body);
-        if (!error && doc.containsKey("program")) {
-            progIdx = doc["program"].as<int>();
+        if (server.hasArg("program")) {
+            progIdx = server.arg("program").toInt();
+        } else {
+            // Parse JSON body
+            String body = server.arg(0);
+            StaticJsonDocument<64> doc;
+            DeserializationError error = deserializeJson(doc, body);
+            if (!error && doc.containsKey("program")) {
+                progIdx = doc["program"].as<int>();
+            }
         }
-        if (progIdx < 0 || progIdx > 2) {
+        if (!ScheduleManager::isValidProgramIndex(progIdx)) {
             server.send(400, "text/plain", "Invalid program index");
             return;
         }
-        scheduleManager.startRunProgramNow(progIdx);
+        if (sendCommandFailure(server, runControlCommand(CommandType::RunProgramNow, -1, progIdx))) return;
         server.send(200, "text/plain", "Run Program Now started");
     });
 
     // Handler for program copy (POST)
-    server.on("/copy_program", HTTP_POST, [&]() {
+    onTimed(server, "/copy_program", HTTP_POST, [&]() {
         if (!server.hasArg("target") || !server.hasArg("source")) {
             server.send(400, "text/plain", "Missing parameters");
             return;
         }
         int target = server.arg("target").toInt();
         int source = server.arg("source").toInt();
-        if (target < 0 || target > 2 || source < 0 || source > 2 || target == source) {
+        if (!ScheduleManager::isValidProgramIndex(target) || !ScheduleManager::isValidProgramIndex(source) || target == source) {
             server.send(400, "text/plain", "Invalid indices");
             return;
         }
-        scheduleManager.copyProgram(target, source);
+        {
+            ControlLock lock;
+            scheduleManager.copyProgram(target, source);
+        }
         server.send(200, "text/plain", "Program copied");
     });
 
     // Handler for instant disable relay from UI
     // Handler for WiFi Setup (GET shows form, POST saves settings)
-    server.on("/wifi_setup", HTTP_GET, [&]() {
+    onTimed(server, "/wifi_setup", HTTP_GET, [&]() {
         // Scan networks
         int n = WiFi.scanNetworks();
         String ssidOptions = "";
@@ -251,7 +340,7 @@ void setupWebServerRoutes(
         html += "</form></body></html>";
         server.send(200, "text/html", html);
     });
-    server.on("/wifi_setup", HTTP_POST, [&]() {
+    onTimed(server, "/wifi_setup", HTTP_POST, [&]() {
         String ssid = server.arg("ssid");
         String password = server.arg("password");
         bool useStatic = server.hasArg("use_static");
@@ -277,12 +366,11 @@ void setupWebServerRoutes(
     });
 
     // Handler for instant disable relay from UI
-    server.on("/disable_zone", HTTP_POST, [&](){
+    onTimed(server, "/disable_zone", HTTP_POST, [&](){
         if (server.hasArg("zone")) {
             int zone = server.arg("zone").toInt();
             if (zone >= 0 && zone < scheduleManager.count) {
-                scheduleManager.sprinklers[zone].disabled = true;
-                scheduleManager.sprinklers[zone].setState(false);
+                if (sendCommandFailure(server, runControlCommand(CommandType::DisableZone, zone))) return;
                 server.send(200, "text/plain", "OK");
                 return;
             }
@@ -291,19 +379,12 @@ void setupWebServerRoutes(
     });
 
     // Handler for instant enable relay from UI
-    server.on("/enable_zone", HTTP_POST, [&](){
+    onTimed(server, "/enable_zone", HTTP_POST, [&](){
         if (server.hasArg("zone")) {
             int zone = server.arg("zone").toInt();
             if (zone >= 0 && zone < scheduleManager.count) {
-                scheduleManager.sprinklers[zone].disabled = false;
-                // Check if it should be ON right now
-                time_t now = time(nullptr);
-                struct tm* t = localtime(&now);
-                int today = t->tm_wday == 0 ? 6 : t->tm_wday - 1;
-                int hour = t->tm_hour;
-                int minute = t->tm_min;
-                bool shouldBeOn = scheduleManager.checkSprinklerSchedule(zone, today, hour, minute);
-                scheduleManager.sprinklers[zone].setState(shouldBeOn);
+                // The control task turns it on right away if it is scheduled now
+                if (sendCommandFailure(server, runControlCommand(CommandType::EnableZone, zone))) return;
                 server.send(200, "text/plain", "OK");
                 return;
             }
@@ -311,55 +392,259 @@ void setupWebServerRoutes(
         server.send(400, "text/plain", "Invalid zone");
     });
     // Route for AJAX time polling
-    server.on("/current_time", HTTP_GET, [&](){ handleCurrentTime(server); });
+    onTimed(server, "/current_time", HTTP_GET, [&](){ handleCurrentTime(server); });
 
     // --- QUICK RUN ENDPOINTS ---
-    server.on("/quick_run/start", HTTP_POST, [&]() {
+    onTimed(server, "/quick_run/start", HTTP_POST, [&]() {
         int duration = 10; // default
         if (server.hasArg("duration")) duration = server.arg("duration").toInt();
-        scheduleManager.startQuickRun(duration, 0);
+        if (sendCommandFailure(server, runControlCommand(CommandType::QuickRunStart, -1, 0, duration))) return;
         server.send(200, "application/json", "{\"result\":true,\"message\":\"Quick Run started\"}");
     });
-    server.on("/quick_run/stop", HTTP_POST, [&]() {
-        scheduleManager.stopQuickRun();
+    onTimed(server, "/quick_run/stop", HTTP_POST, [&]() {
+        if (sendCommandFailure(server, runControlCommand(CommandType::QuickRunStop))) return;
         server.send(200, "application/json", "{\"result\":true,\"message\":\"Quick Run stopped\"}");
     });
-    server.on("/quick_run/status", HTTP_GET, [&]() {
+    onTimed(server, "/quick_run/status", HTTP_GET, [&]() {
+        ControlLock lock;
         String json = "{";
-        json += "\"isActive\":" + String(scheduleManager.isQuickRunActive() ? "true" : "false");
-        json += ",\"currentZone\":" + String(scheduleManager.quickRunCurrentZone);
-        json += ",\"zoneIndex\":" + String(scheduleManager.quickRunZoneIndex);
-        json += ",\"numZones\":" + String(scheduleManager.quickRunNumZones);
-        json += ",\"duration\":" + String(scheduleManager.quickRunDurationPerZone/1000);
-        unsigned long now = millis();
+        const RunArbiter& runs = scheduleManager.runs;
+        uint64_t now = MonotonicClock::nowMs();
+        int segment = runs.currentSegment(RunSource::QuickRun, now);
+        int duration = 0;
         int remaining = 0;
-        if (scheduleManager.isQuickRunActive() && scheduleManager.quickRunCurrentZone >= 0) {
-            unsigned long elapsed = now - scheduleManager.quickRunStartTime;
-            int dur = scheduleManager.quickRunDurationPerZone;
-            remaining = dur > (int)elapsed ? (dur - (int)elapsed)/1000 : 0;
+        if (segment >= 0) {
+            const RunSegment& current = runs.segment(RunSource::QuickRun, segment);
+            duration = (current.endMs - current.startMs) / 1000;
+            remaining = (current.endMs - runs.elapsedMs(RunSource::QuickRun, now)) / 1000;
         }
+        json += "\"isActive\":" + String(scheduleManager.isQuickRunActive() ? "true" : "false");
+        json += ",\"paused\":" + String(runs.isPaused(RunSource::QuickRun) ? "true" : "false");
+        json += ",\"currentZone\":" + String(segment >= 0 ? runs.segment(RunSource::QuickRun, segment).zone : -1);
+        json += ",\"zoneIndex\":" + String(segment >= 0 ? segment : 0);
+        json += ",\"numZones\":" + String(runs.segmentCount(RunSource::QuickRun));
+        json += ",\"duration\":" + String(duration);
         json += ",\"remaining\":" + String(remaining);
         json += "}";
         server.send(200, "application/json", json);
     });
 
+    // --- Next schedule transition and transition latency ---
+    onTimed(server, "/schedule/next", HTTP_GET, [&]() {
+        ControlLock lock;
+        const TransitionLatencyStats& stats = scheduleManager.transitionStats;
+        time_t now = WallClock::now();
+        long secondsUntil = (long)(scheduleManager.nextTransitionTime - now);
+        String json = "{";
+        json += "\"nextTransition\":" + String((long)scheduleManager.nextTransitionTime);
+        json += ",\"secondsUntil\":" + String(secondsUntil > 0 ? secondsUntil : 0);
+        json += ",\"pending\":" + String(scheduleManager.scheduleCheckPending ? "true" : "false");
+        json += ",\"transitions\":" + String(stats.transitions);
+        json += ",\"lastLatencyMs\":" + String(stats.lastLatencyMs);
+        json += ",\"maxLatencyMs\":" + String(stats.maxLatencyMs);
+        json += ",\"avgLatencyMs\":" + String(stats.transitions ? (long)(stats.totalLatencyMs / stats.transitions) : 0L);
+        json += "}";
+        server.send(200, "application/json", json);
+    });
+
+    // --- Quick Run / Run Program Now zone switch jitter (scheduled vs actual) ---
+    onTimed(server, "/run/jitter", HTTP_GET, [&]() {
+        ControlLock lock;
+        const JitterHistogram& jitter = scheduleManager.runTransitionJitter;
+        String json = "{";
+        json += "\"samples\":" + String(jitter.samples);
+        json += ",\"maxMs\":" + String(jitter.maxMs);
+        json += ",\"avgMs\":" + String(jitter.samples ? (long)(jitter.totalMs / jitter.samples) : 0L);
+        json += ",\"limitsMs\":[";
+        for (int b = 0; b < JitterHistogram::BUCKETS - 1; b++) {
+            if (b > 0) json += ",";
+            json += String(JitterHistogram::BUCKET_LIMIT_MS[b]);
+        }
+        json += "],\"counts\":[";
+        for (int b = 0; b < JitterHistogram::BUCKETS; b++) {
+            if (b > 0) json += ",";
+            json += String(jitter.counts[b]);
+        }
+        json += "]}";
+        server.send(200, "application/json", json);
+    });
+
+    // --- Buffered log entries (oldest first) ---
+    onTimed(server, "/log", HTTP_GET, [&]() {
+        String text = "# level " + String(eventLog.level()) + ", recorded " + String(eventLog.recorded()) +
+                      ", dropped " + String(eventLog.dropped()) + "\n";
+        text += eventLog.dump();
+        server.send(200, "text/plain", text);
+    });
+    // --- Runtime log level (POST level=0..3) ---
+    onTimed(server, "/log", HTTP_POST, [&]() {
+        if (!server.hasArg("level")) {
+            server.send(400, "text/plain", "Missing level");
+            return;
+        }
+        int level = server.arg("level").toInt();
+        if (level < LOG_LEVEL_ERROR || level > LOG_LEVEL_DEBUG) {
+            server.send(400, "text/plain", "Invalid level");
+            return;
+        }
+        eventLog.setLevel((uint8_t)level);
+        server.send(200, "text/plain", "Log level " + String(eventLog.level()));
+    });
+
+    // --- Handler and control-phase latency histograms ---
+    onTimed(server, "/latency", HTTP_GET, [&]() {
+        server.send(200, "application/json", latencyStats.toJson());
+    });
+    // --- Clear the latency histograms ---
+    onTimed(server, "/latency", HTTP_POST, [&]() {
+        latencyStats.reset();
+        server.send(200, "text/plain", "Latency histograms cleared");
+    });
+
+    // --- Idle power policy: state, time in each state ---
+    onTimed(server, "/power", HTTP_GET, [&]() {
+        server.send(200, "application/json", powerPolicy.toJson(MonotonicClock::nowMs()));
+    });
+    // --- POST enabled=0 keeps the controller Active, enabled=1 lets the policy run ---
+    onTimed(server, "/power", HTTP_POST, [&]() {
+        if (!server.hasArg("enabled")) {
+            server.send(400, "text/plain", "Missing enabled");
+            return;
+        }
+        powerPolicy.setEnabled(server.arg("enabled").toInt() != 0);
+        server.send(200, "application/json", powerPolicy.toJson(MonotonicClock::nowMs()));
+    });
+
+    // --- Deep sleep between waterings: setting, next program start, wake stats ---
+    onTimed(server, "/deep_sleep", HTTP_GET, [&]() {
+        sendDeepSleepStatus(server, scheduleManager);
+    });
+    // --- POST enabled=0/1 turns deep sleep off/on (saved) ---
+    onTimed(server, "/deep_sleep", HTTP_POST, [&]() {
+        if (!server.hasArg("enabled")) {
+            server.send(400, "text/plain", "Missing enabled");
+            return;
+        }
+        deepSleep.setEnabled(server.arg("enabled").toInt() != 0);
+        sendDeepSleepStatus(server, scheduleManager);
+    });
+
+    // --- Boot progress: clock source, WiFi/NTP times, first schedule decision ---
+    onTimed(server, "/boot", HTTP_GET, [&]() {
+        server.send(200, "application/json", bootStatusToJson(controlSnapshot().firstScheduleMs));
+    });
+
+    // --- Upcoming run days of a program (computed directly, no day-by-day scan) ---
+    onTimed(server, "/schedule/forecast", HTTP_GET, [&]() {
+        int programIndex = server.hasArg("program") ? server.arg("program").toInt() : 0;
+        int days = server.hasArg("count") ? server.arg("count").toInt() : 7;
+        if (!ScheduleManager::isValidProgramIndex(programIndex) || days < 1 || days > 60) {
+            server.send(400, "text/plain", "Invalid program or count");
+            return;
+        }
+        struct tm local;
+        WallClock::localNow(local);
+        struct tm* t = &local;
+        int32_t upcoming[60];
+        Program program;
+        {
+            ControlLock lock;
+            program = scheduleManager.programs[programIndex];
+        }
+        int found = program.enabled ? forecastRunDays(program, epochDayFromTm(*t), upcoming, days) : 0;
+        String json = "{\"program\":" + String(programIndex) + ",\"days\":[";
+        for (int i = 0; i < found; i++) {
+            json += "\"" + formatEpochDay(upcoming[i]) + "\"";
+            if (i < found - 1) json += ",";
+        }
+        json += "]}";
+        server.send(200, "application/json", json);
+    });
+
+    // --- Scheduled minutes per zone over a time range (minute-of-week bitmap scan) ---
+    // from: minute of week (0 = Monday 00:00, default now), minutes: range length (default 24h)
+    onTimed(server, "/schedule/range", HTTP_GET, [&]() {
+        struct tm local;
+        WallClock::localNow(local);
+        struct tm* t = &local;
+        int from = OccupancyIndex::minuteOfWeek((t->tm_wday + 6) % 7, t->tm_hour * 60 + t->tm_min);
+        if (server.hasArg("from")) from = server.arg("from").toInt();
+        int minutes = server.hasArg("minutes") ? server.arg("minutes").toInt() : 1440;
+        if (from < 0 || from >= OccupancyIndex::MINUTES_PER_WEEK || minutes <= 0 || minutes > OccupancyIndex::MINUTES_PER_WEEK) {
+            server.send(400, "text/plain", "Invalid range");
+            return;
+        }
+        String json = "{\"from\":" + String(from) + ",\"minutes\":" + String(minutes) + ",\"zones\":[";
+        ControlLock lock;
+        for (int i = 0; i < scheduleManager.count; i++) {
+            int scheduled = scheduleManager.occupancy.countInRange(i, from, minutes);
+            json += String("{\"id\":") + i + ",\"scheduledMinutes\":" + scheduled + "}";
+            if (i < scheduleManager.count - 1) json += ",";
+        }
+        json += "]}";
+        server.send(200, "application/json", json);
+    });
+
+    // --- Schedule evaluation benchmark (legacy String parse vs integer table) ---
+    onTimed(server, "/bench/schedule", HTTP_GET, [&]() {
+        uint32_t ticks = server.hasArg("ticks") ? server.arg("ticks").toInt() : 1440;
+        if (ticks == 0 || ticks > 100000) ticks = 1440;
+        ScheduleBenchResult result;
+        {
+            ControlLock lock;
+            result = runScheduleTickBenchmark(scheduleManager, ticks);
+        }
+        server.send(200, "application/json", scheduleBenchToJson(result));
+    });
+
+    // --- Schedule engine benchmark at the compiled program/zone count ---
+    onTimed(server, "/bench/compute", HTTP_GET, [&]() {
+        uint32_t iterations = server.hasArg("iterations") ? server.arg("iterations").toInt() : 100;
+        if (iterations == 0 || iterations > 10000) iterations = 100;
+        ScheduleComputeBenchResult result = runScheduleComputeBenchmark(iterations);
+        server.send(200, "application/json", scheduleComputeBenchToJson(result));
+    });
+
+    // --- Run arbitration (control pass) benchmark ---
+    onTimed(server, "/bench/run_tick", HTTP_GET, [&]() {
+        uint32_t ticks = server.hasArg("ticks") ? server.arg("ticks").toInt() : 10000;
+        if (ticks == 0 || ticks > 1000000) ticks = 10000;
+        RunTickBenchResult result = runRunTickBenchmark(ticks);
+        server.send(200, "application/json", runTickBenchToJson(result));
+    });
+
+    // --- Fast-forward simulation of the control logic over a simulated year ---
+    // days: calendar days (default 365, at most YEAR_SIM_MAX_DAYS), trace: relay changes listed (default 20)
+    onTimed(server, "/bench/year", HTTP_GET, [&]() {
+        uint32_t days = server.hasArg("days") ? server.arg("days").toInt() : 365;
+        if (days == 0) days = 365;
+        if (days > YEAR_SIM_MAX_DAYS) days = YEAR_SIM_MAX_DAYS;
+        SimTrace trace = {"[", server.hasArg("trace") ? (int)server.arg("trace").toInt() : 20, 0};
+        if (trace.limit < 0 || trace.limit > 500) trace.limit = 20;
+        YearSimResult result = runYearSimulation(days, simulationStart(), collectSimTrace, &trace);
+        trace.json += "]";
+        server.send(200, "application/json", yearSimToJson(result, trace.json));
+    });
+
+    // --- The same programs with deep sleep between waterings (sleep/wake sequencing, wake-to-relay) ---
+    // days: calendar days (default 31, at most DEEP_SLEEP_SIM_MAX_DAYS)
+    onTimed(server, "/bench/deep_sleep", HTTP_GET, [&]() {
+        uint32_t days = server.hasArg("days") ? server.arg("days").toInt() : 31;
+        if (days == 0) days = 31;
+        if (days > DEEP_SLEEP_SIM_MAX_DAYS) days = DEEP_SLEEP_SIM_MAX_DAYS;
+        SimTrace trace = {"[", server.hasArg("trace") ? (int)server.arg("trace").toInt() : 20, 0};
+        if (trace.limit < 0 || trace.limit > 500) trace.limit = 20;
+        DeepSleepSimResult result = runDeepSleepSimulation(days, simulationStart(), collectSimTrace, &trace);
+        trace.json += "]";
+        server.send(200, "application/json", deepSleepSimToJson(result, trace.json));
+    });
+
     // Program-based scheduling routes
-    server.on("/programs", HTTP_GET, [&](){ handleProgramPage(server, scheduleManager); });
-    server.on("/save_programs", HTTP_POST, [&](){ handleSavePrograms(server, scheduleManager); });
+    onTimed(server, "/programs", HTTP_GET, [&](){ handleProgramPage(server, scheduleManager); });
+    onTimed(server, "/save_programs", HTTP_POST, [&](){ handleSavePrograms(server, scheduleManager); });
 
     // Timezone settings handler
-    // Helper to map timezone name and DST to TZ string
-    auto getTZString = [](const String& tzName, bool dst) -> const char* {
-        if (tzName == "Eastern") return dst ? "EST5EDT,M3.2.0/2,M11.1.0/2" : "EST5";
-        if (tzName == "Central") return dst ? "CST6CDT,M3.2.0/2,M11.1.0/2" : "CST6";
-        if (tzName == "Mountain") return dst ? "MST7MDT,M3.2.0/2,M11.1.0/2" : "MST7";
-        if (tzName == "Pacific") return dst ? "PST8PDT,M3.2.0/2,M11.1.0/2" : "PST8";
-        if (tzName == "Alaska") return dst ? "AKST9AKDT,M3.2.0/2,M11.1.0/2" : "AKST9";
-        if (tzName == "Hawaii") return "HST10"; // Hawaii does not observe DST
-        return "EST5EDT,M3.2.0/2,M11.1.0/2"; // Default
-    };
-
-    server.on("/set_timezone", HTTP_POST, [&](){
+    onTimed(server, "/set_timezone", HTTP_POST, [&](){
         if (!server.hasArg("timezone")) {
             server.send(400, "text/plain", "Missing timezone parameter");
             return;
@@ -375,45 +660,28 @@ void setupWebServerRoutes(
         prefs.putString("timezone", tz);
         prefs.putBool("dst", dst);
         prefs.end();
-        // Apply timezone immediately
-        configTzTime(getTZString(currentTimeZoneName, currentDstEnabled), "pool.ntp.org");
+        {
+            ControlLock lock;
+            // Apply timezone immediately
+            configTzTime(timezoneString(currentTimeZoneName, currentDstEnabled), "pool.ntp.org");
+            // Local wall-clock changed: re-arm the next schedule transition
+            scheduleManager.requestScheduleCheck();
+        }
         server.sendHeader("Location", "/", true);
         server.send(302, "");
     });
 
-    // Helper to load timezone/DST at startup
-    auto loadTimezonePrefs = [&](){
-        Preferences prefs;
-        prefs.begin("sprinkler_time", true);
-        currentTimeZoneName = prefs.getString("timezone", "Eastern");
-        currentDstEnabled = prefs.getBool("dst", false);
-        prefs.end();
-        // Apply timezone on boot
-        configTzTime(getTZString(currentTimeZoneName, currentDstEnabled), "pool.ntp.org");
-    };
-    loadTimezonePrefs();
-
     // Root route
-    server.on("/", HTTP_GET, [&]() { handleRoot(server, scheduleManager, manualState); });
+    onTimed(server, "/", HTTP_GET, [&]() { handleRoot(server, scheduleManager, manualState); });
 
     // Manual mode toggle
-    server.on("/manual", HTTP_POST, [&]() {
+    onTimed(server, "/manual", HTTP_POST, [&]() {
         handleManualMode(server, scheduleManager, manualState);
     });
 
     // Manual control routes for each sprinkler
     for (int i = 0; i < numSprinklers; i++) {
-        // Determine if this sprinkler is active according to the schedule
-        time_t raw = time(nullptr);
-        struct tm* t = localtime(&raw);
-        bool isActive = scheduleManager.checkSprinklerSchedule(
-            i,
-            t->tm_wday == 0 ? 6 : t->tm_wday - 1, // Convert Sunday=0 to 6, Mon=1 to 0, etc.
-            t->tm_hour,
-            t->tm_min
-        );
-        String nameClass = isActive ? "sprinkler-active" : "";
-        server.on("/manual_control" + String(i), HTTP_POST, [&, i]() {
+        onTimed(server, "/manual_control" + String(i), HTTP_POST, [&, i]() {
             handleManualControl(server, scheduleManager, manualState, i);
         });
     }
@@ -555,26 +823,21 @@ void handleRoot(
         </tr>
 )rawliteral";
 
+    // Zone states from the control task's snapshot: rendering never waits for it
+    ControlSnapshot snapshot = controlSnapshot();
     for (int i = 0; i < numSprinklers; i++) {
-        Sprinkler& sprinkler = scheduleManager.getSprinkler(i);
-        // Check if this sprinkler is currently scheduled to be active
-        time_t raw = time(nullptr);
-        struct tm* t = localtime(&raw);
-        bool isActive = scheduleManager.checkSprinklerSchedule(
-            i,
-            t->tm_wday == 0 ? 6 : t->tm_wday - 1, // Convert Sunday=0 to 6, Mon=1 to 0, etc.
-            t->tm_hour,
-            t->tm_min
-        );
+        bool on = (snapshot.zoneOnMask >> i) & 1;
+        // Is this sprinkler currently scheduled to be active
+        bool isActive = (snapshot.scheduledMask >> i) & 1;
         String nameClass = isActive ? "sprinkler-active" : "";
         html += "<tr><td><span class='" + nameClass + "'>Sprinkler " + String(i + 1) + "</span></td>";
-        if (sprinkler.state) {
+        if (on) {
             html += "<td class='status-on'>ON</td>";
         } else {
             html += "<td class='status-off'>OFF</td>";
         }
         html += "<td><form method='POST' action='/manual_control" + String(i) + "'>";
-        html += "<button type='submit' class='btn'>" + String(sprinkler.state ? "Turn OFF" : "Turn ON") + "</button>";
+        html += "<button type='submit' class='btn'>" + String(on ? "Turn OFF" : "Turn ON") + "</button>";
         html += "</form></td></tr>";
     }
 
@@ -738,10 +1001,11 @@ void handleRoot(
  */
 void handleStopQuickRun(WebServer& server, ScheduleManager& scheduleManager) {
     String json = "{ \"sprinklers\": [";
+    ControlSnapshot snapshot = controlSnapshot();
     
     for (int i = 0; i < numSprinklers; i++) {
-        Sprinkler& sprinkler = scheduleManager.getSprinkler(i);
-        json += "{\"id\":" + String(i) + ",\"state\":" + String(sprinkler.state ? "true" : "false") + "}";
+        bool on = (snapshot.zoneOnMask >> i) & 1;
+        json += "{\"id\":" + String(i) + ",\"state\":" + String(on ? "true" : "false") + "}";
         if (i < numSprinklers - 1) json += ",";
     }
     json += "]}";
@@ -756,7 +1020,7 @@ void handleStopQuickRun(WebServer& server, ScheduleManager& scheduleManager) {
  * @param scheduleManager Reference to the schedule manager.
  */
 void handleQuickRun(WebServer& server, ScheduleManager& scheduleManager) {
-    scheduleManager.startQuickRun(10, 0);
+    runControlCommand(CommandType::QuickRunStart, -1, 0, 10);
     server.sendHeader("Location", "/", true);
     server.send(302, "");
 }
@@ -821,31 +1085,16 @@ void handleUpdatePage(WebServer& server) {
 #include "webserver.h"
 
 void handleManualMode(WebServer& server, ScheduleManager& scheduleManager, SprinklerSystemState& manualState) {
-    // Toggle manual mode
-    manualState.setManualMode(!manualState.isManualMode());
-    // If switching to manual, turn off all sprinklers
-    if (manualState.isManualMode()) {
-        for (int i = 0; i < scheduleManager.count; i++) {
-            scheduleManager.sprinklers[i].setState(false);
-        }
-    }
+    // Toggle manual mode (switching to manual turns off all sprinklers)
+    runControlCommand(CommandType::ToggleManualMode);
     // Redirect back to home page
     server.sendHeader("Location", "/", true);
     server.send(302, "text/plain", "");
 }
 
 void handleManualControl(WebServer& server, ScheduleManager& scheduleManager, SprinklerSystemState& manualState, int index) {
-    // Only allow control if manual mode is enabled
-    if (!manualState.isManualMode()) {
-        server.sendHeader("Location", "/", true);
-        server.send(302, "text/plain", "");
-        return;
-    }
-    // Toggle the state of the selected sprinkler zone
-    if (index >= 0 && index < scheduleManager.count) {
-        bool currentState = scheduleManager.sprinklers[index].state;
-        scheduleManager.sprinklers[index].setState(!currentState);
-    }
+    // Toggle the state of the selected sprinkler zone (rejected unless manual mode is enabled)
+    runControlCommand(CommandType::ToggleZone, index);
     // Redirect back to home page
     server.sendHeader("Location", "/", true);
     server.send(302, "text/plain", "");
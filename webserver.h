@@ -20,6 +20,11 @@ extern bool currentDstEnabled;
 
 void setupOTA();
 
+// Apply the stored timezone; call once at boot
+void loadTimezonePreferences();
+// Start NTP; call once WiFi is connected
+void startTimeSync();
+
 void setupWebServerRoutes(
     WebServer& server,
     ScheduleManager& scheduleManager,
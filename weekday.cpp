@@ -2,6 +2,10 @@
 #include <time.h>
 
 String WeekdayUtils::toString(Weekday day) {
+    return name(day);
+}
+
+const char* WeekdayUtils::name(Weekday day) {
     switch (day) {
         case MONDAY:    return "Monday";
         case TUESDAY:   return "Tuesday";
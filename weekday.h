@@ -2,6 +2,7 @@
 #define WEEKDAY_H
 
 #include <Arduino.h>
+#include "wall_clock.h"
 
 enum Weekday { 
     MONDAY = 0, 
@@ -18,6 +19,9 @@ class WeekdayUtils {
 public:
     // Convert Weekday enum to string
     static String toString(Weekday day);
+
+    // Day name as a string literal (safe to keep a pointer to, e.g. in log entries)
+    static const char* name(Weekday day);
     
     // Convert string to Weekday enum
     static Weekday fromString(const String& dayStr);
@@ -30,7 +34,7 @@ public:
     
     // Get today's weekday as an index (0-6)
     static int todayAsIndex() {
-        return (int)fromEpochTime(time(nullptr));
+        return (int)fromEpochTime(WallClock::now());
     }
 };
 